@@ -0,0 +1,230 @@
+// Points/sec of BeizerSplineGenerator's Bernstein and forward-difference
+// modes, and of Bernstein in double, on helical center-lines of 10^3 to
+// 10^6 control points. Then point counts of CreateAdaptiveSpline against
+// the fixed 0.1 step on a mostly straight and a tortuous center-line. Last,
+// BeizerSplineBatch on many short branches against one CreateBeizeSpline
+// call per branch, for every instruction set this CPU has. Exits with 1 if
+// a batch result differs from the per-curve floats.
+
+#include "BeizerSpline.h"
+#include "BeizerSplineBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+using namespace iv;
+
+namespace
+{
+	typedef chrono::high_resolution_clock Clock;
+
+	void MakeCenterline(int ptCnt, vector<vec3>& o_pts)
+	{
+		o_pts.resize(ptCnt);
+		for (int i = 0; i < ptCnt; ++i)
+		{
+			float a = 0.05f * (float)i;
+			o_pts[i] = vec3(cosf(a), sinf(a), 0.02f * (float)i);
+		}
+	}
+
+	// Straight runs joined by a few short bends.
+	void MakeStraightCenterline(int ptCnt, vector<vec3>& o_pts)
+	{
+		o_pts.resize(ptCnt);
+		vec3 p(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < ptCnt; ++i)
+		{
+			float a = (i % 200 < 10) ? 0.15f * (float)(i / 200 + 1) : 0.0f;
+			p += vec3(sinf(a), 0.0f, cosf(a)) * 0.5f;
+			o_pts[i] = p;
+		}
+	}
+
+	// Sparse control points on tight, wobbling turns.
+	void MakeTortuousCenterline(int ptCnt, vector<vec3>& o_pts)
+	{
+		o_pts.resize(ptCnt);
+		for (int i = 0; i < ptCnt; ++i)
+		{
+			float a = 0.7f * (float)i;
+			float r = 1.0f + 0.5f * sinf(0.3f * (float)i);
+			o_pts[i] = vec3(r * cosf(a), r * sinf(a), 0.3f * (float)i);
+		}
+	}
+
+	vec3 Bezier(const vec3* p, float t)
+	{
+		float u = 1.0f - t;
+		return p[0] * (u * u * u) + p[1] * (3.0f * u * u * t) + p[2] * (3.0f * u * t * t) + p[3] * (t * t * t);
+	}
+
+	// Largest distance between the spline and the chords of a fixed t step,
+	// measured at the middle of each step.
+	float FixedStepError(const vector<vec3>& pts, float step)
+	{
+		BeizerSplineGenerator bsg(step);
+		vector<vec3> ctrl;
+		bsg.CreateSegments(pts, ctrl);
+		int stepCnt = bsg.GetSegmentSampleCnt();
+		float maxErr = 0.0f;
+		for (int i = 0; i + 4 <= ctrl.size(); i += 4)
+		{
+			for (int k = 0; k < stepCnt; ++k)
+			{
+				float t0 = step * (float)k;
+				float t1 = min(1.0f, step * (float)(k + 1));
+				vec3 chordMid = (Bezier(&ctrl[i], t0) + Bezier(&ctrl[i], t1)) * 0.5f;
+				maxErr = max(maxErr, length(Bezier(&ctrl[i], 0.5f * (t0 + t1)) - chordMid));
+			}
+		}
+		return maxErr;
+	}
+
+	// branchCnt helical pieces of 4 to 40 points each.
+	void MakeBranches(int branchCnt, vector<vector<vec3>>& o_branches)
+	{
+		o_branches.resize(branchCnt);
+		for (int b = 0; b < branchCnt; ++b)
+		{
+			int ptCnt = 4 + (b * 7) % 37;
+			o_branches[b].resize(ptCnt);
+			for (int i = 0; i < ptCnt; ++i)
+			{
+				float a = 0.3f * (float)i + (float)b;
+				o_branches[b][i] = vec3(cosf(a), sinf(a), 0.1f * (float)i) + vec3((float)(b % 100), (float)(b / 100), 0.0f);
+			}
+		}
+	}
+
+	// Best of reps runs, in points/sec.
+	template<class Type>
+	double Measure(BeizerSplineGeneratorT<Type>& bsg, const vector<Vector3<Type>>& pts, vector<Vector3<Type>>& out, int reps)
+	{
+		double best = 1e30;
+		for (int r = 0; r < reps; ++r)
+		{
+			Clock::time_point start = Clock::now();
+			bsg.CreateBeizeSpline(pts, out);
+			best = min(best, chrono::duration<double>(Clock::now() - start).count());
+		}
+		return out.size() / best;
+	}
+}
+
+int main()
+{
+	printf("%10s %12s %14s %14s %8s %12s %14s\n", "ctrl pts", "spline pts", "bernstein/s", "fwd-diff/s", "gain", "max dev", "double/s");
+
+	vector<vec3> pts, ref, fd;
+	vector<dvec3> dpts, dref;
+	for (int ptCnt = 1000; ptCnt <= 1000000; ptCnt *= 10)
+	{
+		MakeCenterline(ptCnt, pts);
+		int reps = max(3, 3000000 / ptCnt);
+
+		BeizerSplineGenerator bernstein(0.1f, BeizerSplineGenerator::Bernstein);
+		BeizerSplineGenerator forward(0.1f, BeizerSplineGenerator::ForwardDifference);
+		double bRate = Measure(bernstein, pts, ref, reps);
+		double fRate = Measure(forward, pts, fd, reps);
+
+		dpts.resize(pts.size());
+		for (int i = 0; i < pts.size(); ++i)
+			dpts[i] = dvec3(pts[i].x, pts[i].y, pts[i].z);
+		BeizerSplineGeneratorD bernsteinD(0.1f);
+		double dRate = Measure(bernsteinD, dpts, dref, reps);
+
+		float maxDev = 0.0f;
+		for (int i = 0; i < ref.size(); ++i)
+			maxDev = max(maxDev, length(ref[i] - fd[i]));
+
+		printf("%10d %12d %14.4g %14.4g %7.2fx %12.3g %14.4g\n", ptCnt, (int)ref.size(), bRate, fRate, fRate / bRate, maxDev, dRate);
+	}
+
+	printf("\n%10s %10s %12s %12s %14s %10s %12s %14s\n", "centerline", "tolerance", "fixed pts", "fixed err", "adaptive pts", "ratio", "max err", "adaptive/s");
+
+	const char* names[2] = { "straight", "tortuous" };
+	const float tolerances[3] = { 1e-2f, 1e-3f, 1e-4f };
+	vector<vec3> adaptive;
+	for (int c = 0; c < 2; ++c)
+	{
+		if (c == 0)
+			MakeStraightCenterline(10000, pts);
+		else
+			MakeTortuousCenterline(10000, pts);
+
+		BeizerSplineGenerator bsg(0.1f);
+		int fixedCnt = bsg.GetSplinePtCnt(pts.size());
+		float fixedErr = FixedStepError(pts, 0.1f);
+		for (int t = 0; t < 3; ++t)
+		{
+			BeizerSplineGenerator::AdaptiveStats st;
+			double best = 1e30;
+			for (int r = 0; r < 20; ++r)
+			{
+				Clock::time_point start = Clock::now();
+				bsg.CreateAdaptiveSpline(pts, tolerances[t], adaptive, &st);
+				best = min(best, chrono::duration<double>(Clock::now() - start).count());
+			}
+			printf("%10s %10.0e %12d %12.3g %14d %9.2fx %12.3g %14.4g\n", names[c], tolerances[t], fixedCnt, fixedErr, st.PtCnt,
+				(double)fixedCnt / st.PtCnt, st.MaxError, st.PtCnt / best);
+		}
+	}
+
+	printf("\n%10s %12s %10s %14s %8s %6s\n", "branches", "spline pts", "isa", "points/s", "gain", "same");
+
+	vector<vector<vec3>> branches;
+	bool allSame = true;
+	for (int branchCnt = 100; branchCnt <= 100000; branchCnt *= 10)
+	{
+		MakeBranches(branchCnt, branches);
+		int reps = max(3, 300000 / branchCnt);
+
+		BeizerSplineGenerator bsg(0.1f);
+		BeizerSplineBatch batch(0.1f);
+		for (int b = 0; b < branchCnt; ++b)
+			batch.AddCurve(branches[b]);
+		ref.resize(batch.GetPtCnt());
+
+		double best = 1e30;
+		for (int r = 0; r < reps; ++r)
+		{
+			Clock::time_point start = Clock::now();
+			vec3* out = &ref[0];
+			for (int b = 0; b < branchCnt; ++b)
+			{
+				bsg.CreateBeizeSpline(branches[b], out);
+				out += bsg.GetSplinePtCnt(branches[b].size());
+			}
+			best = min(best, chrono::duration<double>(Clock::now() - start).count());
+		}
+		double scalarRate = ref.size() / best;
+		printf("%10d %12d %10s %14.4g %7.2fx %6s\n", branchCnt, (int)ref.size(), "per curve", scalarRate, 1.0, "-");
+
+		vector<vec3> out(batch.GetPtCnt());
+		for (int isa = BeizerSplineBatch::Scalar; isa <= BeizerSplineBatch::GetBestIsa(); ++isa)
+		{
+			best = 1e30;
+			for (int r = 0; r < reps; ++r)
+			{
+				Clock::time_point start = Clock::now();
+				batch.Evaluate((BeizerSplineBatch::Isa)isa, &out[0]);
+				best = min(best, chrono::duration<double>(Clock::now() - start).count());
+			}
+			bool same = memcmp(&out[0], &ref[0], out.size() * sizeof(vec3)) == 0;
+			printf("%10d %12d %10s %14.4g %7.2fx %6s\n", branchCnt, (int)out.size(), BeizerSplineBatch::GetIsaName((BeizerSplineBatch::Isa)isa),
+				out.size() / best, out.size() / best / scalarRate, same ? "yes" : "no");
+			allSame = allSame && same;
+		}
+	}
+
+	if (!allSame)
+	{
+		fprintf(stderr, "BeizerSplineBatch output differs from CreateBeizeSpline\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,279 @@
+#pragma once
+
+// Small stand-in for Google Benchmark: registered cases are run until
+// they take --benchmark_min_time seconds and the results are printed as a
+// table or as Google Benchmark compatible JSON, so the nightly tooling
+// can read them the same way.
+//
+//   --benchmark_filter=<substring>
+//   --benchmark_min_time=<seconds>      default 0.2
+//   --benchmark_format=console|json     default console
+//   --benchmark_out=<file>              JSON copy of the results
+//   --check_only                        run the checks, skip the cases
+//
+// Registered checks run first, filtered the same way. Main returns 1 if
+// one of them fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <utility>
+#include <thread>
+#include <vector>
+
+namespace bench
+{
+	// Keeps the optimizer from dropping a result.
+	template<typename Type>
+	inline void DoNotOptimize(const Type& v)
+	{
+		static volatile const void* s_Sink;
+		s_Sink = &v;
+		(void)s_Sink;
+	}
+
+	typedef std::vector<std::pair<std::string, double>> CounterList;
+
+	// Extra per-case values, like Google Benchmark user counters. Set from
+	// inside a case's Run, the values of the last run are reported.
+	inline CounterList& CurrentCounters()
+	{
+		static CounterList s_Counters;
+		return s_Counters;
+	}
+
+	inline void SetCounter(const std::string& name, double value)
+	{
+		CounterList& counters = CurrentCounters();
+		for (int i = 0; i < counters.size(); ++i)
+		{
+			if (counters[i].first == name)
+			{
+				counters[i].second = value;
+				return;
+			}
+		}
+		counters.push_back(std::make_pair(name, value));
+	}
+
+	// Seconds spent in SetupScope during the current run.
+	inline double& ExcludedSeconds()
+	{
+		static double s_Seconds = 0.0;
+		return s_Seconds;
+	}
+
+	// Time inside this scope isn't counted, like PauseTiming in Google
+	// Benchmark. For one-off preparation inside a case.
+	class SetupScope
+	{
+	public:
+		SetupScope() : m_Start(std::chrono::high_resolution_clock::now())
+		{
+		}
+
+		~SetupScope()
+		{
+			ExcludedSeconds() += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_Start).count();
+		}
+
+	private:
+		std::chrono::high_resolution_clock::time_point m_Start;
+	};
+
+	struct Case
+	{
+		std::string Name;
+		// Runs the measured work iterations times. Returns items processed
+		// per iteration, used for items_per_second.
+		std::function<double(long long iterations)> Run;
+	};
+
+	struct Check
+	{
+		std::string Name;
+		// Prints what went wrong and returns false on failure.
+		std::function<bool()> Run;
+	};
+
+	struct Result
+	{
+		std::string Name;
+		long long Iterations;
+		double NsPerIter;
+		double ItemsPerSec;
+		CounterList Counters;
+	};
+
+	class Registry
+	{
+	public:
+		void Add(const std::string& name, const std::function<double(long long)>& run)
+		{
+			Case c;
+			c.Name = name;
+			c.Run = run;
+			m_Cases.push_back(c);
+		}
+
+		void AddCheck(const std::string& name, const std::function<bool()>& run)
+		{
+			Check c;
+			c.Name = name;
+			c.Run = run;
+			m_Checks.push_back(c);
+		}
+
+		int Main(int argc, char** argv)
+		{
+			std::string filter, format = "console", out;
+			double minTime = 0.2;
+			bool checkOnly = false;
+			for (int i = 1; i < argc; ++i)
+			{
+				std::string arg = argv[i];
+				if (arg.compare(0, 19, "--benchmark_filter=") == 0)
+					filter = arg.substr(19);
+				else if (arg.compare(0, 21, "--benchmark_min_time=") == 0)
+					minTime = atof(arg.c_str() + 21);
+				else if (arg.compare(0, 19, "--benchmark_format=") == 0)
+					format = arg.substr(19);
+				else if (arg.compare(0, 16, "--benchmark_out=") == 0)
+					out = arg.substr(16);
+				else if (arg == "--check_only")
+					checkOnly = true;
+			}
+
+			// Check results go to stderr in JSON mode, stdout holds the JSON.
+			bool console = (format != "json");
+			int failedCnt = 0;
+			for (int i = 0; i < m_Checks.size(); ++i)
+			{
+				const Check& c = m_Checks[i];
+				if (!filter.empty() && c.Name.find(filter) == std::string::npos)
+					continue;
+				bool ok = c.Run();
+				fprintf(console ? stdout : stderr, "%-48s %s\n", c.Name.c_str(), ok ? "OK" : "FAILED");
+				if (!ok)
+					++failedCnt;
+			}
+			if (checkOnly)
+				return failedCnt > 0 ? 1 : 0;
+
+			if (console)
+				printf("%-48s %14s %14s %14s\n", "Benchmark", "Time(ns)", "Iterations", "items/s");
+
+			std::vector<Result> results;
+			for (int i = 0; i < m_Cases.size(); ++i)
+			{
+				const Case& c = m_Cases[i];
+				if (!filter.empty() && c.Name.find(filter) == std::string::npos)
+					continue;
+				Result r = Measure(c, minTime);
+				results.push_back(r);
+				if (console)
+				{
+					printf("%-48s %14.1f %14lld %14.4g", r.Name.c_str(), r.NsPerIter, r.Iterations, r.ItemsPerSec);
+					for (int k = 0; k < r.Counters.size(); ++k)
+						printf(" %s=%g", r.Counters[k].first.c_str(), r.Counters[k].second);
+					printf("\n");
+					fflush(stdout);
+				}
+			}
+
+			if (!console)
+				WriteJson(stdout, results);
+			if (!out.empty())
+			{
+				FILE* f = fopen(out.c_str(), "w");
+				if (f == 0)
+				{
+					fprintf(stderr, "can't open %s\n", out.c_str());
+					return 1;
+				}
+				WriteJson(f, results);
+				fclose(f);
+			}
+			return failedCnt > 0 ? 1 : 0;
+		}
+
+	private:
+		static Result Measure(const Case& c, double minTime)
+		{
+			typedef std::chrono::high_resolution_clock Clock;
+
+			long long iterations = 1;
+			double items = 0.0;
+			double seconds = 0.0;
+			for (;;)
+			{
+				CurrentCounters().clear();
+				ExcludedSeconds() = 0.0;
+				Clock::time_point start = Clock::now();
+				items = c.Run(iterations);
+				seconds = std::chrono::duration<double>(Clock::now() - start).count() - ExcludedSeconds();
+				if (seconds >= minTime || iterations >= 1000000000LL)
+					break;
+				// Aim a bit past minTime, but never grow more than 10x at once.
+				double scale = (seconds > 0.0) ? 1.4 * minTime / seconds : 10.0;
+				iterations = (long long)(iterations * std::min(10.0, std::max(2.0, scale)));
+			}
+
+			Result r;
+			r.Name = c.Name;
+			r.Iterations = iterations;
+			r.NsPerIter = seconds * 1e9 / iterations;
+			r.ItemsPerSec = items * iterations / seconds;
+			r.Counters = CurrentCounters();
+			return r;
+		}
+
+		static void WriteJson(FILE* f, const std::vector<Result>& results)
+		{
+			char date[64];
+			time_t now = time(0);
+			strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+			fprintf(f, "{\n  \"context\": {\n");
+			fprintf(f, "    \"date\": \"%s\",\n", date);
+			fprintf(f, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+			fprintf(f, "    \"library_build_type\": \"%s\"\n", BuildType());
+			fprintf(f, "  },\n  \"benchmarks\": [\n");
+			for (int i = 0; i < results.size(); ++i)
+			{
+				const Result& r = results[i];
+				fprintf(f, "    {\n");
+				fprintf(f, "      \"name\": \"%s\",\n", r.Name.c_str());
+				fprintf(f, "      \"run_name\": \"%s\",\n", r.Name.c_str());
+				fprintf(f, "      \"run_type\": \"iteration\",\n");
+				fprintf(f, "      \"iterations\": %lld,\n", r.Iterations);
+				fprintf(f, "      \"real_time\": %.6g,\n", r.NsPerIter);
+				fprintf(f, "      \"cpu_time\": %.6g,\n", r.NsPerIter);
+				fprintf(f, "      \"time_unit\": \"ns\",\n");
+				fprintf(f, "      \"items_per_second\": %.6g%s\n", r.ItemsPerSec, r.Counters.empty() ? "" : ",");
+				for (int k = 0; k < r.Counters.size(); ++k)
+					fprintf(f, "      \"%s\": %.6g%s\n", r.Counters[k].first.c_str(), r.Counters[k].second, (k + 1 < r.Counters.size()) ? "," : "");
+				fprintf(f, "    }%s\n", (i + 1 < results.size()) ? "," : "");
+			}
+			fprintf(f, "  ]\n}\n");
+		}
+
+		static const char* BuildType()
+		{
+#ifdef NDEBUG
+			return "release";
+#else
+			return "debug";
+#endif
+		}
+
+	private:
+		std::vector<Case> m_Cases;
+		std::vector<Check> m_Checks;
+	};
+}
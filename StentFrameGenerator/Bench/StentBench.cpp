@@ -0,0 +1,1143 @@
+// Stage and end-to-end benchmarks of the stent generator, swept over
+// sample count, period count and center-line length, after checks of the
+// properties the generator promises.
+//
+//   StentBench --benchmark_format=json --benchmark_out=stent.json
+//   StentBench --check_only
+
+#include "BenchHarness.h"
+#include "BeizerSpline.h"
+#include "RingKernel.h"
+#include "RingTemplate.h"
+#include "SinCosTable.h"
+#include "StentFrameGenerator.h"
+#include "StentFrameIO.h"
+#include "StentMeshGenerator.h"
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+
+using namespace std;
+using namespace iv;
+
+// Every heap allocation of the process goes through here, so the pipeline
+// cases can report allocations per steady-state call.
+static atomic<long long> s_AllocCnt(0);
+
+void* operator new(size_t size)
+{
+	++s_AllocCnt;
+	void* p = malloc(size ? size : 1);
+	if (p == 0)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+
+// Friend of StentFrameGenerator, reaches the private stages.
+class StentFrameBench
+{
+public:
+	typedef StentFrameGenerator::TNB TNB;
+
+	static void CreateStentLine(const StentFrameGenerator& sfg, const TNB& tnb, vec3* o_pts)
+	{
+		sfg.CreateStentLine(tnb, o_pts);
+	}
+
+	template<class Type>
+	static void UpdateTNBFrames(const StentFrameGeneratorT<Type>& sfg, const vector<Vector3<Type>>& pts,
+		vector<typename StentFrameGeneratorT<Type>::TNB>& o_frames)
+	{
+		sfg.UpdateTNBFrames(pts.empty() ? 0 : &pts[0], pts.size(), o_frames);
+	}
+};
+
+namespace
+{
+	const int s_Designs[][2] = { { 16, 6 }, { 32, 12 }, { 64, 24 } };
+	const int s_Lengths[] = { 10, 100, 1000, 10000 };
+
+	// Helix with a slow wobble, ptCnt points about 0.2 apart.
+	void MakeCenterline(int ptCnt, vector<vec3>& o_pts)
+	{
+		o_pts.resize(ptCnt);
+		for (int i = 0; i < ptCnt; ++i)
+		{
+			float a = 0.05f * (float)i;
+			o_pts[i] = vec3(3.0f * cosf(a), 3.0f * sinf(a), 0.1f * (float)i + sinf(0.01f * (float)i));
+		}
+	}
+
+	string Name(const char* base, int a)
+	{
+		return string(base) + "/" + to_string(a);
+	}
+
+	string Name(const char* base, int a, int b)
+	{
+		return Name(base, a) + "/" + to_string(b);
+	}
+
+	string Name(const char* base, int a, int b, int c)
+	{
+		return Name(base, a, b) + "/" + to_string(c);
+	}
+
+	void AddStageBenchmarks(bench::Registry& reg)
+	{
+		for (int d = 0; d < 3; ++d)
+		{
+			int sampleCnt = s_Designs[d][0];
+			int periodCnt = s_Designs[d][1];
+
+			// Building a design's sin/cos table, what the first generator of
+			// the design pays. Later ones share it, see BM_ConstructGenerator.
+			reg.Add(Name("BM_BuildSinCosTable", sampleCnt, periodCnt), [=](long long iterations)
+			{
+				for (long long i = 0; i < iterations; ++i)
+				{
+					SinCosTable table(sampleCnt, periodCnt);
+					bench::DoNotOptimize(table);
+				}
+				return (double)(sampleCnt + sampleCnt * periodCnt);
+			});
+
+			// A generator per request, no other one of the design alive.
+			// cold: the caches are purged first, so its tables are built
+			// again every time. shared: construction only looks them up.
+			for (int w = 0; w < 2; ++w)
+			{
+				bool shared = (w == 1);
+				reg.Add(Name(shared ? "BM_ConstructGenerator/shared" : "BM_ConstructGenerator/cold", sampleCnt, periodCnt), [=](long long iterations)
+				{
+					for (long long i = 0; i < iterations; ++i)
+					{
+						if (!shared)
+						{
+							SinCosTable::Purge();
+							RingTemplate::Purge();
+						}
+						StentFrameGenerator sfg(sampleCnt, periodCnt, 0.1f, 0.02f, true);
+						bench::DoNotOptimize(sfg);
+					}
+					return 1.0;
+				});
+			}
+
+			reg.Add(Name("BM_CreateStentLine", sampleCnt, periodCnt), [=](long long iterations)
+			{
+				StentFrameGenerator sfg(sampleCnt, periodCnt, 0.1f, 0.02f, true);
+				StentFrameGenerator::TNB tnb;
+				tnb.T = normalize(vec3(0.2f, 1.0f, 0.1f));
+				tnb.N = normalize(cross(vec3(1.0f, 0.0f, 0.0f), tnb.T));
+				tnb.B = cross(tnb.N, tnb.T);
+				tnb.O = vec3(1.0f, 2.0f, 3.0f);
+				vector<vec3> ring(sfg.GetRingPtCnt());
+				for (long long i = 0; i < iterations; ++i)
+				{
+					StentFrameBench::CreateStentLine(sfg, tnb, &ring[0]);
+					bench::DoNotOptimize(ring[0]);
+				}
+				return (double)ring.size();
+			});
+
+			// The ring transform alone.
+			reg.Add(Name("BM_RingKernel", sampleCnt, periodCnt), [=](long long iterations)
+			{
+				int cnt = sampleCnt * periodCnt;
+				vector<float> lx(cnt), ly(cnt), lz(cnt);
+				for (int i = 0; i < cnt; ++i)
+				{
+					lx[i] = sinf(0.37f * (float)i);
+					ly[i] = cosf(0.11f * (float)i);
+					lz[i] = 0.01f * (float)i;
+				}
+				vec3 o(1.0f, 2.0f, 3.0f), vx(0.0f, 0.0f, 1.0f), vy(0.0f, 1.0f, 0.0f), vz(1.0f, 0.0f, 0.0f);
+				vector<vec3> ring(cnt);
+				for (long long i = 0; i < iterations; ++i)
+				{
+					RingKernel::Transform(&lx[0], &ly[0], &lz[0], cnt, o, vx, vy, vz, &ring[0]);
+					bench::DoNotOptimize(ring[0]);
+				}
+				return (double)cnt;
+			});
+		}
+
+		for (int l = 0; l < 4; ++l)
+		{
+			int ptCnt = s_Lengths[l];
+
+			reg.Add(Name("BM_CreateBeizeSpline", ptCnt), [=](long long iterations)
+			{
+				vector<vec3> pts, out;
+				MakeCenterline(ptCnt, pts);
+				BeizerSplineGenerator bsg(0.1f);
+				for (long long i = 0; i < iterations; ++i)
+				{
+					bsg.CreateBeizeSpline(pts, out);
+					bench::DoNotOptimize(out[0]);
+				}
+				return (double)out.size();
+			});
+
+			const char* modeNames[2] = { "BM_UpdateTNBFrames/rotate", "BM_UpdateTNBFrames/reflect" };
+			for (int m = 0; m < 2; ++m)
+			{
+				StentFrameGenerator::FrameMode mode = (m == 0) ? StentFrameGenerator::RotateFrame : StentFrameGenerator::DoubleReflection;
+				reg.Add(Name(modeNames[m], ptCnt), [=](long long iterations)
+				{
+					vector<vec3> pts;
+					MakeCenterline(ptCnt, pts);
+					StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+					sfg.SetFrameMode(mode);
+					vector<StentFrameBench::TNB> frames;
+					for (long long i = 0; i < iterations; ++i)
+					{
+						StentFrameBench::UpdateTNBFrames(sfg, pts, frames);
+						bench::DoNotOptimize(frames[0]);
+					}
+					return (double)frames.size();
+				});
+			}
+		}
+	}
+
+	struct PipelineConfig
+	{
+		const char* Name;
+		bool SplineFit;
+		StentFrameGenerator::ResampleMode Mode;
+		float Spacing;
+	};
+
+	const PipelineConfig s_Pipelines[] =
+	{
+		{ "BM_CreateStentFrame/polyline", false, StentFrameGenerator::SampleGap, 0.0f },
+		{ "BM_CreateStentFrame/spline", true, StentFrameGenerator::SampleGap, 0.0f },
+		{ "BM_CreateStentFrame/arclength", true, StentFrameGenerator::ArcLength, 0.0f },
+		{ "BM_CreateStentFrame/spacing", true, StentFrameGenerator::ArcLength, 0.5f }
+	};
+
+	// End-to-end generation into a reused FrameBuffer and Scratch. The first
+	// call is a warm-up, allocs_per_iter counts heap allocations after it
+	// and stays 0, see AddAllocationChecks.
+	void AddPipelineBenchmarks(bench::Registry& reg)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			for (int d = 0; d < 3; ++d)
+			{
+				for (int l = 0; l < 4; ++l)
+				{
+					PipelineConfig cfg = s_Pipelines[c];
+					int sampleCnt = s_Designs[d][0];
+					int periodCnt = s_Designs[d][1];
+					int ptCnt = s_Lengths[l];
+					reg.Add(Name(cfg.Name, sampleCnt, periodCnt, ptCnt), [=](long long iterations)
+					{
+						vector<vec3> pts;
+						MakeCenterline(ptCnt, pts);
+						StentFrameGenerator sfg(sampleCnt, periodCnt, 0.1f, 0.02f, cfg.SplineFit);
+						sfg.SetResampleMode(cfg.Mode, cfg.Spacing);
+						StentFrameGenerator::Scratch scratch;
+						StentFrameGenerator::FrameBuffer buf;
+						sfg.Reserve(ptCnt, scratch, buf);
+						sfg.CreateStentFrame(pts, buf, scratch);
+
+						long long allocs = s_AllocCnt;
+						for (long long i = 0; i < iterations; ++i)
+						{
+							sfg.CreateStentFrame(pts, buf, scratch);
+							bench::DoNotOptimize(buf.Pts[0]);
+						}
+						bench::SetCounter("allocs_per_iter", (double)(s_AllocCnt - allocs) / iterations);
+						return (double)buf.Pts.size();
+					});
+				}
+			}
+		}
+	}
+
+	// Allocations of one call after a warm-up call of the same size, must
+	// be 0 for every output overload and pipeline. Without a pool, which
+	// allocates its job on every ParallelFor.
+	void AddAllocationChecks(bench::Registry& reg)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			PipelineConfig cfg = s_Pipelines[c];
+			string name = string("Check_ZeroAllocations") + strchr(cfg.Name, '/');
+			reg.AddCheck(name, [=]()
+			{
+				vector<vec3> pts;
+				MakeCenterline(1000, pts);
+				StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, cfg.SplineFit);
+				sfg.SetResampleMode(cfg.Mode, cfg.Spacing);
+				StentFrameGenerator::Scratch scratch;
+				StentFrameGenerator::FrameBuffer buf;
+				vector<vector<vec3>> rings;
+				vector<vec3> raw(sfg.GetFrameCnt(pts) * sfg.GetRingPtCnt());
+
+				const char* overloads[4] = { "Scratch", "FrameBuffer", "FrameBuffer+Scratch", "raw pointer" };
+				bool ok = true;
+				for (int o = 0; o < 4; ++o)
+				{
+					long long allocs = 0;
+					for (int call = 0; call < 2; ++call)
+					{
+						long long before = s_AllocCnt;
+						if (o == 0)
+							sfg.CreateStentFrame(pts, rings, scratch);
+						else if (o == 1)
+							sfg.CreateStentFrame(pts, buf);
+						else if (o == 2)
+							sfg.CreateStentFrame(pts, buf, scratch);
+						else
+							sfg.CreateStentFrame(pts, &raw[0], raw.size(), scratch);
+						allocs = s_AllocCnt - before;
+					}
+					if (allocs != 0)
+					{
+						fprintf(stderr, "%s: %lld allocations in the %s overload after warm-up\n", name.c_str(), allocs, overloads[o]);
+						ok = false;
+					}
+				}
+				return ok;
+			});
+		}
+	}
+
+	// The streamable pipelines fed 256 points at a time into 64-ring sink
+	// calls, against BM_CreateStentFrame/polyline and /spacing.
+	// stream_bytes is the capacity of the stream's buffers afterwards and
+	// stays flat with the center-line length, full_bytes that of the
+	// FrameBuffer and Scratch CreateStentFrame needs for the same stent.
+	void AddStreamBenchmarks(bench::Registry& reg)
+	{
+		const int streamPipelines[] = { 0, 3 };
+		for (int c = 0; c < 2; ++c)
+		{
+			for (int l = 1; l < 4; ++l)
+			{
+				PipelineConfig cfg = s_Pipelines[streamPipelines[c]];
+				int ptCnt = s_Lengths[l];
+				string name = string("BM_CreateStentStream") + strchr(cfg.Name, '/');
+				reg.Add(Name(name.c_str(), 32, 12, ptCnt), [=](long long iterations)
+				{
+					vector<vec3> pts;
+					MakeCenterline(ptCnt, pts);
+					StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, cfg.SplineFit);
+					sfg.SetResampleMode(cfg.Mode, cfg.Spacing);
+					StentFrameGenerator::Stream stream;
+					long long ringPtCnt = 0;
+					auto sink = [&](const vec3* rings, int /*firstRing*/, int ringCnt)
+					{
+						bench::DoNotOptimize(rings[0]);
+						ringPtCnt += (long long)ringCnt * sfg.GetRingPtCnt();
+						return true;
+					};
+					for (long long i = 0; i < iterations; ++i)
+					{
+						sfg.BeginStream(stream, ptCnt, 64, sink);
+						for (int j = 0; j < ptCnt; j += 256)
+							sfg.PushStream(stream, &pts[j], min(256, ptCnt - j));
+						sfg.EndStream(stream);
+					}
+
+					{
+						bench::SetupScope setup;
+						size_t streamBytes = (stream.Pts.capacity() + stream.BezierPts.capacity() + stream.Ctrl.capacity()
+							+ stream.HeldPts.capacity() + stream.SamplePts.capacity()) * sizeof(vec3)
+							+ stream.Frames.capacity() * sizeof(StentFrameGenerator::TNB) + stream.Rings.capacity() * sizeof(vec3);
+						StentFrameGenerator::Scratch scratch;
+						StentFrameGenerator::FrameBuffer buf;
+						sfg.CreateStentFrame(pts, buf, scratch);
+						size_t fullBytes = (scratch.BezierPts.capacity() + scratch.SamplePts.capacity() + buf.Pts.capacity()) * sizeof(vec3)
+							+ scratch.Frames.capacity() * sizeof(StentFrameGenerator::TNB) + buf.RingOffsets.capacity() * sizeof(int);
+						bench::SetCounter("stream_bytes", (double)streamBytes);
+						bench::SetCounter("full_bytes", (double)fullBytes);
+					}
+					return (double)ringPtCnt / iterations;
+				});
+			}
+		}
+	}
+
+	// Rings of one stent split across a ThreadPool with all hardware threads,
+	// against BM_CreateStentFrame/polyline for the serial path, and frames
+	// propagated by RotateScan.
+	void AddParallelBenchmarks(bench::Registry& reg)
+	{
+		for (int l = 1; l < 4; ++l)
+		{
+			int ptCnt = s_Lengths[l];
+			reg.Add(Name("BM_CreateStentFrame/pool", 32, 12, ptCnt), [=](long long iterations)
+			{
+				vector<vec3> pts;
+				MakeCenterline(ptCnt, pts);
+				ThreadPool pool(0);
+				StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+				sfg.SetThreadPool(&pool);
+				StentFrameGenerator::Scratch scratch;
+				StentFrameGenerator::FrameBuffer buf;
+				sfg.CreateStentFrame(pts, buf, scratch);
+				for (long long i = 0; i < iterations; ++i)
+				{
+					sfg.CreateStentFrame(pts, buf, scratch);
+					bench::DoNotOptimize(buf.Pts[0]);
+				}
+				bench::SetCounter("threads", (double)pool.GetSlotCnt());
+				return (double)buf.Pts.size();
+			});
+		}
+
+		// Frame propagation alone on long center lines, serial RotateFrame
+		// against RotateScan on the pool. max_err is the largest N or B
+		// difference to RotateFrame, in float mostly RotateFrame's own acos
+		// rounding. Check_RotateScan holds it to a limit.
+		const int scanLengths[] = { 10000, 100000, 1000000 };
+		for (int l = 0; l < 3; ++l)
+		{
+			int ptCnt = scanLengths[l];
+			for (int m = 0; m < 2; ++m)
+			{
+				bool scan = (m == 1);
+				reg.Add(Name(scan ? "BM_UpdateTNBFrames/scan" : "BM_UpdateTNBFrames/serial", ptCnt), [=](long long iterations)
+				{
+					vector<vec3> pts;
+					MakeCenterline(ptCnt, pts);
+					ThreadPool pool(0);
+					StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+					if (scan)
+					{
+						sfg.SetFrameMode(StentFrameGenerator::RotateScan);
+						sfg.SetThreadPool(&pool);
+					}
+					vector<StentFrameBench::TNB> frames;
+					for (long long i = 0; i < iterations; ++i)
+					{
+						StentFrameBench::UpdateTNBFrames(sfg, pts, frames);
+						bench::DoNotOptimize(frames[0]);
+					}
+
+					{
+						bench::SetupScope setup;
+						StentFrameGenerator ref(32, 12, 0.1f, 0.02f, false);
+						vector<StentFrameBench::TNB> refFrames;
+						StentFrameBench::UpdateTNBFrames(ref, pts, refFrames);
+						float maxErr = 0.0f;
+						for (size_t i = 0; i < frames.size(); ++i)
+						{
+							maxErr = max(maxErr, length(frames[i].N - refFrames[i].N));
+							maxErr = max(maxErr, length(frames[i].B - refFrames[i].B));
+						}
+						bench::SetCounter("max_err", maxErr);
+						bench::SetCounter("threads", scan ? (double)pool.GetSlotCnt() : 1.0);
+					}
+					return (double)frames.size();
+				});
+			}
+		}
+	}
+
+	template<class Type>
+	double GetScanErr(int ptCnt, ThreadPool* pool)
+	{
+		vector<vec3> fpts;
+		MakeCenterline(ptCnt, fpts);
+		vector<Vector3<Type>> pts(ptCnt);
+		for (int i = 0; i < ptCnt; ++i)
+			pts[i] = Vector3<Type>(fpts[i].x, fpts[i].y, fpts[i].z);
+
+		StentFrameGeneratorT<Type> ref(32, 12, 0.1f, 0.02f, false);
+		StentFrameGeneratorT<Type> scan(32, 12, 0.1f, 0.02f, false);
+		scan.SetFrameMode(StentFrameGeneratorT<Type>::RotateScan);
+		scan.SetThreadPool(pool);
+		vector<typename StentFrameGeneratorT<Type>::TNB> refFrames, frames;
+		StentFrameBench::UpdateTNBFrames(ref, pts, refFrames);
+		StentFrameBench::UpdateTNBFrames(scan, pts, frames);
+		if (frames.size() != refFrames.size())
+			return 1e30;
+
+		double err = 0.0;
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			err = max(err, (double)length(frames[i].N - refFrames[i].N));
+			err = max(err, (double)length(frames[i].B - refFrames[i].B));
+		}
+		return err;
+	}
+
+	// RotateScan against serial RotateFrame, on and off a pool. Lengths
+	// put the last frame just past one and two 4096-frame chunks, the
+	// long one has 24 of them. The difference grows with the length as
+	// RotateFrame's acos rounding adds up.
+	void AddScanChecks(bench::Registry& reg)
+	{
+		reg.AddCheck("Check_RotateScan", []()
+		{
+			const int lengths[] = { 4097, 4098, 4099, 8194, 8195, 100000 };
+			const double floatTol = 1e-3;
+			const double doubleTol = 1e-10;
+			ThreadPool pool(3);
+			bool ok = true;
+			for (int l = 0; l < 6; ++l)
+			{
+				for (int p = 0; p < 2; ++p)
+				{
+					ThreadPool* usePool = (p == 1) ? &pool : 0;
+					double floatErr = GetScanErr<float>(lengths[l], usePool);
+					double doubleErr = GetScanErr<double>(lengths[l], usePool);
+					if (floatErr > floatTol || doubleErr > doubleTol)
+					{
+						fprintf(stderr, "Check_RotateScan: %d points%s, N/B differ by %g in float (limit %g), %g in double (limit %g)\n",
+							lengths[l], usePool ? " on a pool" : "", floatErr, floatTol, doubleErr, doubleTol);
+						ok = false;
+					}
+				}
+			}
+			return ok;
+		});
+	}
+
+	// CreateStentFrame on a pool against the calling thread alone, for every
+	// pipeline, frame mode and output overload, which must match bit for
+	// bit. 10000 points give RotateScan more than one chunk of frames.
+	void AddPoolChecks(bench::Registry& reg)
+	{
+		reg.AddCheck("Check_ThreadPool", []()
+		{
+			const int lengths[] = { 1000, 10000 };
+			const StentFrameGenerator::FrameMode modes[3] = { StentFrameGenerator::RotateFrame, StentFrameGenerator::DoubleReflection, StentFrameGenerator::RotateScan };
+			const char* overloads[3] = { "vector", "FrameBuffer", "raw pointer" };
+			ThreadPool pool(3);
+			bool ok = true;
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int m = 0; m < 3; ++m)
+				{
+					for (int l = 0; l < 2; ++l)
+					{
+						const PipelineConfig& cfg = s_Pipelines[c];
+						vector<vec3> pts;
+						MakeCenterline(lengths[l], pts);
+						StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, cfg.SplineFit);
+						sfg.SetResampleMode(cfg.Mode, cfg.Spacing);
+						sfg.SetFrameMode(modes[m]);
+						int ptCnt = sfg.GetFrameCnt(pts) * sfg.GetRingPtCnt();
+
+						// [0] serial, [1] on the pool, each overload flattened.
+						vector<vec3> out[3][2];
+						for (int p = 0; p < 2; ++p)
+						{
+							sfg.SetThreadPool(p == 1 ? &pool : 0);
+							StentFrameGenerator::Scratch scratch;
+							vector<vector<vec3>> rings;
+							sfg.CreateStentFrame(pts, rings, scratch);
+							for (size_t i = 0; i < rings.size(); ++i)
+								out[0][p].insert(out[0][p].end(), rings[i].begin(), rings[i].end());
+							StentFrameGenerator::FrameBuffer buf;
+							sfg.CreateStentFrame(pts, buf, scratch);
+							out[1][p] = buf.Pts;
+							out[2][p].resize(ptCnt);
+							if (sfg.CreateStentFrame(pts, &out[2][p][0], ptCnt, scratch) < 0)
+								out[2][p].clear();
+						}
+
+						for (int o = 0; o < 3; ++o)
+						{
+							bool same = out[o][0].size() == (size_t)ptCnt && out[o][1].size() == (size_t)ptCnt
+								&& memcmp(&out[o][0][0], &out[o][1][0], ptCnt * sizeof(vec3)) == 0;
+							if (!same)
+							{
+								fprintf(stderr, "Check_ThreadPool: %s, frame mode %d, %d points, the %s overload differs on the pool\n",
+									strchr(cfg.Name, '/') + 1, (int)modes[m], lengths[l], overloads[o]);
+								ok = false;
+							}
+						}
+					}
+				}
+			}
+			return ok;
+		});
+	}
+
+	// One control point dragged back and forth in the middle of the center
+	// line, against a full CreateStentFrame of the same input in
+	// BM_CreateStentFrame. rings_per_iter counts the rewritten rings.
+	void AddUpdateBenchmarks(bench::Registry& reg)
+	{
+		const char* names[2] = { "BM_UpdateControlPoint/polyline", "BM_UpdateControlPoint/spline" };
+		for (int c = 0; c < 2; ++c)
+		{
+			for (int l = 0; l < 4; ++l)
+			{
+				bool splineFit = c == 1;
+				int ptCnt = s_Lengths[l];
+				reg.Add(Name(names[c], 32, 12, ptCnt), [=](long long iterations)
+				{
+					vector<vec3> pts;
+					MakeCenterline(ptCnt, pts);
+					StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, splineFit);
+					StentFrameGenerator::Scratch scratch;
+					StentFrameGenerator::FrameBuffer buf;
+					sfg.CreateStentFrame(pts, buf, scratch);
+
+					int k = ptCnt / 2;
+					vec3 p0 = pts[k];
+					long long rings = 0;
+					for (long long i = 0; i < iterations; ++i)
+					{
+						vec3 pos = p0 + vec3(0.0f, 0.0f, (i & 1) ? 0.05f : -0.05f);
+						rings += buf.RingCnt - sfg.UpdateControlPoint(pts, k, pos, buf, scratch);
+						bench::DoNotOptimize(buf.Pts[0]);
+					}
+					bench::SetCounter("rings_per_iter", (double)rings / iterations);
+					return (double)buf.Pts.size();
+				});
+			}
+		}
+	}
+
+	// Random control point moves through UpdateControlPoint, each followed
+	// by a fresh CreateStentFrame of the same input, whose rings must match
+	// bit for bit. Polyline and SampleGap spline in both frame modes, and
+	// ArcLength, which falls back to the full path.
+	void AddUpdateChecks(bench::Registry& reg)
+	{
+		reg.AddCheck("Check_UpdateControlPoint", []()
+		{
+			struct UpdateConfig
+			{
+				const char* Name;
+				bool SplineFit;
+				StentFrameGenerator::ResampleMode Mode;
+				float Spacing;
+			};
+			const UpdateConfig configs[] =
+			{
+				{ "polyline", false, StentFrameGenerator::SampleGap, 0.0f },
+				{ "spline", true, StentFrameGenerator::SampleGap, 0.0f },
+				{ "arclength", true, StentFrameGenerator::ArcLength, 0.0f },
+				{ "spacing", true, StentFrameGenerator::ArcLength, 0.5f }
+			};
+			const StentFrameGenerator::FrameMode modes[2] = { StentFrameGenerator::RotateFrame, StentFrameGenerator::DoubleReflection };
+
+			bool ok = true;
+			srand(14);
+			for (int c = 0; c < 4; ++c)
+			{
+				for (int m = 0; m < 2; ++m)
+				{
+					const UpdateConfig& cfg = configs[c];
+					vector<vec3> pts;
+					MakeCenterline(200, pts);
+					StentFrameGenerator sfg(16, 6, 0.1f, 0.02f, cfg.SplineFit);
+					sfg.SetResampleMode(cfg.Mode, cfg.Spacing);
+					sfg.SetFrameMode(modes[m]);
+					StentFrameGenerator::Scratch scratch, refScratch;
+					StentFrameGenerator::FrameBuffer buf, ref;
+					sfg.CreateStentFrame(pts, buf, scratch);
+
+					for (int move = 0; move < 50; ++move)
+					{
+						// Ends and their neighbours included.
+						int k = (move < 4) ? (move < 2 ? move : (int)pts.size() - 1 - (move - 2)) : rand() % (int)pts.size();
+						vec3 d((float)(rand() % 201 - 100), (float)(rand() % 201 - 100), (float)(rand() % 201 - 100));
+						sfg.UpdateControlPoint(pts, k, pts[k] + d * 0.002f, buf, scratch);
+						sfg.CreateStentFrame(pts, ref, refScratch);
+
+						bool same = buf.RingCnt == ref.RingCnt && buf.Pts.size() == ref.Pts.size()
+							&& memcmp(&buf.Pts[0], &ref.Pts[0], buf.Pts.size() * sizeof(vec3)) == 0;
+						if (!same)
+						{
+							fprintf(stderr, "Check_UpdateControlPoint: %s, frame mode %d, move %d of point %d differs from CreateStentFrame\n",
+								cfg.Name, (int)modes[m], move, k);
+							ok = false;
+							break;
+						}
+					}
+				}
+			}
+			return ok;
+		});
+	}
+
+	// Streams pts in pieces of pushCnt points into chunkRingCnt-ring sink
+	// calls and compares the rings with CreateStentFrame of all points.
+	// return: false if the stream failed or gave other rings, o_same
+	//         whether they match bit for bit, o_err the largest coordinate
+	//         difference.
+	template<class Type>
+	bool CompareStream(const PipelineConfig& cfg, StentFrameGenerator::FrameMode mode, const vector<vec3>& fpts,
+		int pushCnt, int chunkRingCnt, bool& o_same, double& o_err)
+	{
+		typedef StentFrameGeneratorT<Type> Generator;
+		int ptCnt = (int)fpts.size();
+		vector<Vector3<Type>> pts(ptCnt);
+		for (int i = 0; i < ptCnt; ++i)
+			pts[i] = Vector3<Type>(fpts[i].x, fpts[i].y, fpts[i].z);
+
+		Generator sfg(16, 6, 0.1f, 0.02f, cfg.SplineFit);
+		// The float enums, same values in every instantiation.
+		sfg.SetResampleMode((typename Generator::ResampleMode)cfg.Mode, cfg.Spacing);
+		sfg.SetFrameMode((typename Generator::FrameMode)mode);
+		typename Generator::FrameBuffer ref;
+		sfg.CreateStentFrame(pts, ref);
+
+		int ringPtCnt = sfg.GetRingPtCnt();
+		vector<vec3> rings;
+		bool inOrder = true;
+		auto sink = [&](const vec3* chunk, int firstRing, int ringCnt)
+		{
+			inOrder = inOrder && firstRing * ringPtCnt == (int)rings.size() && ringCnt > 0 && ringCnt <= chunkRingCnt;
+			rings.insert(rings.end(), chunk, chunk + ringCnt * ringPtCnt);
+			return true;
+		};
+		typename Generator::Stream stream;
+		if (!sfg.BeginStream(stream, ptCnt, chunkRingCnt, sink))
+			return false;
+		for (int i = 0; i < ptCnt; i += pushCnt)
+			sfg.PushStream(stream, &pts[i], min(pushCnt, ptCnt - i));
+		if (!sfg.EndStream(stream) || !inOrder || rings.size() != ref.Pts.size())
+			return false;
+
+		o_same = rings.empty() || memcmp(&rings[0], &ref.Pts[0], rings.size() * sizeof(vec3)) == 0;
+		o_err = 0.0;
+		for (size_t i = 0; i < rings.size(); ++i)
+		{
+			vec3 d = rings[i] - ref.Pts[i];
+			o_err = max(o_err, (double)max(fabsf(d.x), max(fabsf(d.y), fabsf(d.z))));
+		}
+		return true;
+	}
+
+	// Streamed rings against CreateStentFrame of the same points, for every
+	// pipeline that streams, in float and double, pushed one point at a
+	// time up to all at once and sunk one ring at a time up to 64. Bit for
+	// bit, except in RotateScan mode, whose frames only match up to
+	// rounding.
+	void AddStreamChecks(bench::Registry& reg)
+	{
+		const int streamPipelines[] = { 0, 1, 3 };
+		for (int c = 0; c < 3; ++c)
+		{
+			PipelineConfig cfg = s_Pipelines[streamPipelines[c]];
+			string name = string("Check_Stream") + strchr(cfg.Name, '/');
+			reg.AddCheck(name, [=]()
+			{
+				const int ptCnt = 600;
+				const int pushCnts[] = { 1, 3, 256, ptCnt };
+				const int chunkRingCnts[] = { 1, 7, 64 };
+				const StentFrameGenerator::FrameMode modes[3] = { StentFrameGenerator::RotateFrame, StentFrameGenerator::DoubleReflection, StentFrameGenerator::RotateScan };
+				const double scanTol = 1e-4;
+				vector<vec3> pts;
+				MakeCenterline(ptCnt, pts);
+
+				bool ok = true;
+				for (int m = 0; m < 3; ++m)
+				{
+					for (int p = 0; p < 4; ++p)
+					{
+						for (int k = 0; k < 3; ++k)
+						{
+							for (int t = 0; t < 2; ++t)
+							{
+								bool same = false;
+								double err = 0.0;
+								bool streamed = (t == 0)
+									? CompareStream<float>(cfg, modes[m], pts, pushCnts[p], chunkRingCnts[k], same, err)
+									: CompareStream<double>(cfg, modes[m], pts, pushCnts[p], chunkRingCnts[k], same, err);
+								if (streamed && (same || (modes[m] == StentFrameGenerator::RotateScan && err <= scanTol)))
+									continue;
+								fprintf(stderr, "%s: %s, frame mode %d, %d points per push, %d rings per sink call: ",
+									name.c_str(), t == 0 ? "float" : "double", (int)modes[m], pushCnts[p], chunkRingCnts[k]);
+								if (streamed)
+									fprintf(stderr, "rings differ by %g\n", err);
+								else
+									fprintf(stderr, "stream failed or gave other rings\n");
+								ok = false;
+							}
+						}
+					}
+				}
+				return ok;
+			});
+		}
+	}
+
+	struct PrecisionCase
+	{
+		vector<vec3> Pts;
+		vector<dvec3> DPts;
+		vector<dvec3> Local;
+		// Rings of the double path, what max_err is measured against.
+		vector<dvec3> RefRings;
+		double FloatErr, MixedErr;
+		double FloatOrtho, MixedOrtho, DoubleOrtho;
+		double FloatFrameErr;
+	};
+
+	// Ring coordinates of the RingTemplate math, without float rounding.
+	void MakeDoubleRingTemplate(const StentFrameGeneratorD& sfg, vector<dvec3>& o_local)
+	{
+		int sampleCnt = sfg.GetSampleCnt();
+		int total = sampleCnt * sfg.GetPeriodCnt();
+		o_local.resize(total);
+		for (int i = 0; i < total; ++i)
+		{
+			double a2 = 2.0 * M_PI * i / total;
+			double a = 2.0 * M_PI * (i % sampleCnt) / sampleCnt;
+			o_local[i] = dvec3(sfg.GetXzScale() * sin(a2), sfg.GetYScale() * sin(a), sfg.GetXzScale() * cos(a2));
+		}
+	}
+
+	void CreateDoubleRings(const vector<StentFrameGeneratorD::TNB>& frames, const vector<dvec3>& local, vector<dvec3>& o_pts)
+	{
+		int total = local.size();
+		int ringPtCnt = total + 1;
+		o_pts.resize(frames.size() * ringPtCnt);
+		for (size_t f = 0; f < frames.size(); ++f)
+		{
+			const StentFrameGeneratorD::TNB& tnb = frames[f];
+			dvec3* ring = &o_pts[f * ringPtCnt];
+			for (int i = 0; i < total; ++i)
+				ring[i] = tnb.O + tnb.N * local[i].x + tnb.T * local[i].y + tnb.B * local[i].z;
+			ring[total] = ring[0];
+		}
+	}
+
+	template<class Type>
+	double GetOrthoErr(const vector<typename StentFrameGeneratorT<Type>::TNB>& frames)
+	{
+		double err = 0.0;
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			err = max(err, fabs((double)dot(frames[i].N, frames[i].T)));
+			err = max(err, fabs((double)length(frames[i].N) - 1.0));
+		}
+		return err;
+	}
+
+	double GetMaxErr(const vector<vec3>& pts, const vector<dvec3>& ref)
+	{
+		double err = 0.0;
+		for (size_t i = 0; i < pts.size(); ++i)
+		{
+			dvec3 d(pts[i].x - ref[i].x, pts[i].y - ref[i].y, pts[i].z - ref[i].z);
+			err = max(err, length(d));
+		}
+		return err;
+	}
+
+	shared_ptr<PrecisionCase> MakePrecisionCase(int ptCnt)
+	{
+		shared_ptr<PrecisionCase> pc = make_shared<PrecisionCase>();
+		MakeCenterline(ptCnt, pc->Pts);
+		pc->DPts.resize(ptCnt);
+		for (int i = 0; i < ptCnt; ++i)
+			pc->DPts[i] = dvec3(pc->Pts[i].x, pc->Pts[i].y, pc->Pts[i].z);
+
+		StentFrameGenerator sfg(16, 6, 0.1f, 0.02f, false);
+		StentFrameGeneratorD sfgD(16, 6, 0.1f, 0.02f, false);
+
+		vector<StentFrameGeneratorD::TNB> dframes;
+		StentFrameBench::UpdateTNBFrames(sfgD, pc->DPts, dframes);
+		MakeDoubleRingTemplate(sfgD, pc->Local);
+		CreateDoubleRings(dframes, pc->Local, pc->RefRings);
+		pc->DoubleOrtho = GetOrthoErr<double>(dframes);
+
+		vector<StentFrameGenerator::TNB> frames;
+		StentFrameBench::UpdateTNBFrames(sfg, pc->Pts, frames);
+		pc->FloatOrtho = GetOrthoErr<float>(frames);
+		pc->FloatFrameErr = 0.0;
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			const vec3& n = frames[i].N;
+			dvec3 d(n.x - dframes[i].N.x, n.y - dframes[i].N.y, n.z - dframes[i].N.z);
+			pc->FloatFrameErr = max(pc->FloatFrameErr, length(d));
+		}
+		pc->MixedOrtho = pc->DoubleOrtho;
+
+		StentFrameGenerator::FrameBuffer buf;
+		sfg.CreateStentFrame(pc->Pts, buf);
+		pc->FloatErr = GetMaxErr(buf.Pts, pc->RefRings);
+		StentFrameGeneratorD::FrameBuffer dbuf;
+		sfgD.CreateStentFrame(pc->DPts, dbuf);
+		pc->MixedErr = GetMaxErr(dbuf.Pts, pc->RefRings);
+		return pc;
+	}
+
+	// Frame propagation over long polyline center lines, 16x6 rings: float
+	// throughout, double frames with float rings (mixed), and double
+	// throughout. max_err is the farthest ring point from the double path,
+	// which float output rounding alone bounds from below far from the
+	// origin. frame_err is the largest N difference to the double frames,
+	// ortho_err the worst |N.T| or |N|-1 among the frames.
+	void AddPrecisionBenchmarks(bench::Registry& reg)
+	{
+		const int lengths[] = { 1000, 10000, 50000 };
+		for (int l = 0; l < 3; ++l)
+		{
+			int ptCnt = lengths[l];
+			shared_ptr<shared_ptr<PrecisionCase>> lazy = make_shared<shared_ptr<PrecisionCase>>();
+			// Built on first use, so filtered-out lengths cost nothing.
+			auto get = [=]() -> PrecisionCase&
+			{
+				bench::SetupScope setup;
+				if (!*lazy)
+					*lazy = MakePrecisionCase(ptCnt);
+				return **lazy;
+			};
+
+			reg.Add(Name("BM_FramePrecision/float", ptCnt), [=](long long iterations)
+			{
+				PrecisionCase& pc = get();
+				StentFrameGenerator sfg(16, 6, 0.1f, 0.02f, false);
+				StentFrameGenerator::Scratch scratch;
+				StentFrameGenerator::FrameBuffer buf;
+				for (long long i = 0; i < iterations; ++i)
+				{
+					sfg.CreateStentFrame(pc.Pts, buf, scratch);
+					bench::DoNotOptimize(buf.Pts[0]);
+				}
+				bench::SetCounter("max_err", pc.FloatErr);
+				bench::SetCounter("frame_err", pc.FloatFrameErr);
+				bench::SetCounter("ortho_err", pc.FloatOrtho);
+				return (double)buf.Pts.size();
+			});
+
+			reg.Add(Name("BM_FramePrecision/mixed", ptCnt), [=](long long iterations)
+			{
+				PrecisionCase& pc = get();
+				StentFrameGeneratorD sfg(16, 6, 0.1f, 0.02f, false);
+				StentFrameGeneratorD::Scratch scratch;
+				StentFrameGeneratorD::FrameBuffer buf;
+				for (long long i = 0; i < iterations; ++i)
+				{
+					sfg.CreateStentFrame(pc.DPts, buf, scratch);
+					bench::DoNotOptimize(buf.Pts[0]);
+				}
+				bench::SetCounter("max_err", pc.MixedErr);
+				bench::SetCounter("frame_err", 0.0);
+				bench::SetCounter("ortho_err", pc.MixedOrtho);
+				return (double)buf.Pts.size();
+			});
+
+			reg.Add(Name("BM_FramePrecision/double", ptCnt), [=](long long iterations)
+			{
+				PrecisionCase& pc = get();
+				StentFrameGeneratorD sfg(16, 6, 0.1f, 0.02f, false);
+				vector<StentFrameGeneratorD::TNB> frames;
+				vector<dvec3> rings;
+				for (long long i = 0; i < iterations; ++i)
+				{
+					StentFrameBench::UpdateTNBFrames(sfg, pc.DPts, frames);
+					CreateDoubleRings(frames, pc.Local, rings);
+					bench::DoNotOptimize(rings[0]);
+				}
+				bench::SetCounter("max_err", 0.0);
+				bench::SetCounter("frame_err", 0.0);
+				bench::SetCounter("ortho_err", pc.DoubleOrtho);
+				return (double)rings.size();
+			});
+		}
+	}
+
+	const char* s_OutputPath = "StentBench_output.tmp";
+
+	// Sums of the points read back, so the reads can't be dropped.
+	volatile float s_Checksum;
+
+	// The demo's two output formats, written and read back for one
+	// 32x12 stent per center-line length.
+	void AddOutputBenchmarks(bench::Registry& reg)
+	{
+		for (int l = 1; l < 4; ++l)
+		{
+			int ptCnt = s_Lengths[l];
+
+			reg.Add(Name("BM_WriteResult/text", ptCnt), [=](long long iterations)
+			{
+				vector<vec3> pts;
+				MakeCenterline(ptCnt, pts);
+				StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+				StentFrameGenerator::FrameBuffer buf;
+				sfg.CreateStentFrame(pts, buf);
+				for (long long i = 0; i < iterations; ++i)
+				{
+					std::ofstream rf(s_OutputPath);
+					for (size_t j = 0; j < buf.Pts.size(); ++j)
+					{
+						const vec3& p = buf.Pts[j];
+						rf << p.x << "\t" << p.y << "\t" << p.z << "\n";
+					}
+				}
+				remove(s_OutputPath);
+				return (double)buf.Pts.size();
+			});
+
+			reg.Add(Name("BM_WriteResult/binary", ptCnt), [=](long long iterations)
+			{
+				vector<vec3> pts;
+				MakeCenterline(ptCnt, pts);
+				StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+				StentFrameGenerator::FrameBuffer buf;
+				sfg.CreateStentFrame(pts, buf);
+				StentFrameWriter writer;
+				for (long long i = 0; i < iterations; ++i)
+				{
+					writer.Open(s_OutputPath, StentFrameWriter::MakeHeader(sfg));
+					writer.WriteRings(&buf.Pts[0], buf.RingCnt);
+					writer.Close();
+				}
+				remove(s_OutputPath);
+				return (double)buf.Pts.size();
+			});
+
+			reg.Add(Name("BM_ReadResult/text", ptCnt), [=](long long iterations)
+			{
+				vector<vec3> pts;
+				MakeCenterline(ptCnt, pts);
+				StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+				StentFrameGenerator::FrameBuffer buf;
+				sfg.CreateStentFrame(pts, buf);
+				{
+					std::ofstream rf(s_OutputPath);
+					for (size_t j = 0; j < buf.Pts.size(); ++j)
+					{
+						const vec3& p = buf.Pts[j];
+						rf << p.x << "\t" << p.y << "\t" << p.z << "\n";
+					}
+				}
+				for (long long i = 0; i < iterations; ++i)
+				{
+					std::ifstream rf(s_OutputPath);
+					vec3 p, sum(0.0f, 0.0f, 0.0f);
+					while (rf >> p.x >> p.y >> p.z)
+						sum += p;
+					s_Checksum = sum.x + sum.y + sum.z;
+				}
+				remove(s_OutputPath);
+				return (double)buf.Pts.size();
+			});
+
+			reg.Add(Name("BM_ReadResult/mapped", ptCnt), [=](long long iterations)
+			{
+				vector<vec3> pts;
+				MakeCenterline(ptCnt, pts);
+				StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+				StentFrameGenerator::FrameBuffer buf;
+				sfg.CreateStentFrame(pts, buf);
+				StentFrameWriter writer;
+				writer.Open(s_OutputPath, StentFrameWriter::MakeHeader(sfg));
+				writer.WriteRings(&buf.Pts[0], buf.RingCnt);
+				writer.Close();
+				StentFrameReader reader;
+				for (long long i = 0; i < iterations; ++i)
+				{
+					reader.Open(s_OutputPath);
+					const vec3* p = reader.GetPts();
+					vec3 sum(0.0f, 0.0f, 0.0f);
+					for (int j = 0, n = reader.GetRingCnt() * reader.GetRingPtCnt(); j < n; ++j)
+						sum += p[j];
+					s_Checksum = sum.x + sum.y + sum.z;
+				}
+				reader.Close();
+				remove(s_OutputPath);
+				return (double)buf.Pts.size();
+			});
+		}
+	}
+	// Strut mesh over the rings of one CreateStentFrame, serial and on a
+	// pool. tris_per_iter is the triangle count of the mesh.
+	void AddMeshBenchmarks(bench::Registry& reg)
+	{
+		const char* profileNames[2] = { "circle", "rect" };
+		for (int p = 0; p < 2; ++p)
+		{
+			for (int t = 0; t < 2; ++t)
+			{
+				for (int l = 0; l < 3; ++l)
+				{
+					StentMeshGenerator::Profile profile = (p == 0) ? StentMeshGenerator::Circle : StentMeshGenerator::Rectangle;
+					bool threaded = (t == 1);
+					int ptCnt = s_Lengths[l];
+					string name = string("BM_CreateMesh/") + profileNames[p] + (threaded ? "/pool" : "/serial");
+					reg.Add(Name(name.c_str(), ptCnt), [=](long long iterations)
+					{
+						vector<vec3> pts;
+						MakeCenterline(ptCnt, pts);
+						StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, false);
+						StentFrameGenerator::Scratch scratch;
+						StentFrameGenerator::FrameBuffer buf;
+						sfg.CreateStentFrame(pts, buf, scratch);
+
+						std::unique_ptr<ThreadPool> pool(threaded ? new ThreadPool(0) : 0);
+						StentMeshGenerator smg(profile, 0.01f, 0.005f, 6);
+						StentMeshGenerator::Mesh mesh;
+						smg.CreateMesh(buf, scratch.Frames, mesh, pool.get());
+						for (long long i = 0; i < iterations; ++i)
+						{
+							smg.CreateMesh(buf, scratch.Frames, mesh, pool.get());
+							bench::DoNotOptimize(mesh.Positions[0]);
+						}
+						bench::SetCounter("tris_per_iter", (double)(mesh.Indices.size() / 3));
+						return (double)mesh.Positions.size();
+					});
+				}
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Registry reg;
+	AddAllocationChecks(reg);
+	AddScanChecks(reg);
+	AddPoolChecks(reg);
+	AddUpdateChecks(reg);
+	AddStreamChecks(reg);
+	AddStageBenchmarks(reg);
+	AddPipelineBenchmarks(reg);
+	AddStreamBenchmarks(reg);
+	AddParallelBenchmarks(reg);
+	AddUpdateBenchmarks(reg);
+	AddPrecisionBenchmarks(reg);
+	AddOutputBenchmarks(reg);
+	AddMeshBenchmarks(reg);
+	return reg.Main(argc, argv);
+}
@@ -0,0 +1,120 @@
+using System;
+using System.Diagnostics;
+using System.Globalization;
+using System.IO;
+using StentGlue;
+
+namespace StentGlueBench
+{
+    /* Compares the old viewer path, running the demo exe and parsing its
+     * result.txt, with calling the generator in process through StentGlue.
+     * Both paths generate the demo's center line, so their rings must agree
+     * up to the text precision; a mismatch fails with exit code 1.
+     *
+     * usage: StentGlueBench <demo exe> [file iterations] [call iterations]
+     */
+    internal static class Program
+    {
+        // Center line and parameters of the demo's main().
+        private static readonly float[] s_DemoPts =
+        {
+            0.0f, 0.0f, 0.0f,
+            1.0f, 0.0f, 0.0f,
+            1.0f, 1.0f, 0.0f,
+            1.0f, 1.0f, 1.0f,
+        };
+
+        private const float s_Tolerance = 1e-4f;
+
+        private static int Main(string[] args)
+        {
+            if (args.Length < 1)
+            {
+                Console.Error.WriteLine("usage: StentGlueBench <demo exe> [file iterations] [call iterations]");
+                return 2;
+            }
+
+            string demoExe = Path.GetFullPath(args[0]);
+            int fileIters = args.Length > 1 ? int.Parse(args[1]) : 20;
+            int callIters = args.Length > 2 ? int.Parse(args[2]) : 20000;
+
+            string workDir = Path.Combine(Path.GetTempPath(), "StentGlueBench_" + Environment.ProcessId);
+            Directory.CreateDirectory(workDir);
+            try
+            {
+                return Run(demoExe, workDir, fileIters, callIters);
+            }
+            finally
+            {
+                Directory.Delete(workDir, true);
+            }
+        }
+
+        private static int Run(string demoExe, string workDir, int fileIters, int callIters)
+        {
+            float[] filePts = null;
+            Stopwatch sw = Stopwatch.StartNew();
+            for (int i = 0; i < fileIters; ++i)
+                filePts = GenerateThroughFile(demoExe, workDir);
+            double fileSec = sw.Elapsed.TotalSeconds / fileIters;
+
+            using (StentGlue.StentFrameGenerator sfg = new StentGlue.StentFrameGenerator(32, 12, 0.1f, 0.02f, true))
+            {
+                float[] rings = new float[sfg.GetFrameCount(s_DemoPts) * sfg.RingPointCount * 3];
+                int ringCnt = sfg.CreateStentFrame(s_DemoPts, rings);
+
+                sw.Restart();
+                for (int i = 0; i < callIters; ++i)
+                    sfg.CreateStentFrame(s_DemoPts, rings);
+                double callSec = sw.Elapsed.TotalSeconds / callIters;
+
+                Console.WriteLine("rings {0}, points {1}", ringCnt, rings.Length / 3);
+                Console.WriteLine("file   {0,12:F3} us/frame {1,12:F1} frames/s", fileSec * 1e6, 1.0 / fileSec);
+                Console.WriteLine("pinvoke{0,12:F3} us/frame {1,12:F1} frames/s", callSec * 1e6, 1.0 / callSec);
+                Console.WriteLine("speedup {0:F1}x", fileSec / callSec);
+
+                if (filePts.Length != rings.Length)
+                {
+                    Console.Error.WriteLine("point count mismatch: file {0}, pinvoke {1}", filePts.Length / 3, rings.Length / 3);
+                    return 1;
+                }
+
+                float maxErr = 0.0f;
+                for (int i = 0; i < rings.Length; ++i)
+                    maxErr = Math.Max(maxErr, Math.Abs(filePts[i] - rings[i]));
+                Console.WriteLine("max difference {0:E2}", maxErr);
+                return maxErr <= s_Tolerance ? 0 : 1;
+            }
+        }
+
+        // One frame the way the viewer used to get it.
+        private static float[] GenerateThroughFile(string demoExe, string workDir)
+        {
+            string resultPath = Path.Combine(workDir, "result.txt");
+            File.Delete(resultPath);
+
+            ProcessStartInfo psi = new ProcessStartInfo(demoExe, "--text");
+            psi.WorkingDirectory = workDir;
+            psi.UseShellExecute = false;
+            psi.RedirectStandardInput = true;
+            psi.RedirectStandardOutput = true;
+            using (Process proc = Process.Start(psi))
+            {
+                // The demo waits for two key presses before it exits.
+                proc.StandardInput.Close();
+                proc.StandardOutput.ReadToEnd();
+                proc.WaitForExit();
+            }
+
+            string[] lines = File.ReadAllLines(resultPath);
+            float[] pts = new float[lines.Length * 3];
+            for (int i = 0; i < lines.Length; ++i)
+            {
+                string[] cols = lines[i].Split('\t');
+                for (int j = 0; j < 3; ++j)
+                    pts[3 * i + j] = float.Parse(cols[j], CultureInfo.InvariantCulture);
+            }
+            return pts;
+        }
+    }
+}
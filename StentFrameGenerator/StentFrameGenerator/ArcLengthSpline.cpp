@@ -0,0 +1,153 @@
+#include "ArcLengthSpline.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// 5-point Gauss-Legendre on [-1, 1], rounded once per scalar type.
+	template<class Type>
+	struct Gauss
+	{
+		static const Type X[5];
+		static const Type W[5];
+	};
+
+	template<class Type>
+	const Type Gauss<Type>::X[5] = { (Type)-0.9061798459L, (Type)-0.5384693101L, (Type)0, (Type)0.5384693101L, (Type)0.9061798459L };
+	template<class Type>
+	const Type Gauss<Type>::W[5] = { (Type)0.2369268851L, (Type)0.4786286705L, (Type)0.5688888889L, (Type)0.4786286705L, (Type)0.2369268851L };
+}
+
+template<class Type>
+ArcLengthSplineT<Type>::ArcLengthSplineT() : m_Bezier(0.1f)
+{
+}
+
+template<class Type>
+void ArcLengthSplineT<Type>::Build(const std::vector<Vec3>& i_pts)
+{
+	Build(i_pts.empty() ? 0 : &i_pts[0], i_pts.size());
+}
+
+template<class Type>
+void ArcLengthSplineT<Type>::Build(const Vec3* i_pts, int ptCnt)
+{
+	m_Bezier.CreateSegments(i_pts, ptCnt, m_Ctrl);
+
+	int segCnt = m_Ctrl.size() / 4;
+	m_SegEnds.resize(segCnt);
+	Type total = 0;
+	for (int i = 0; i < segCnt; ++i)
+	{
+		total += GetSegmentLength(&m_Ctrl[4 * i]);
+		m_SegEnds[i] = total;
+	}
+}
+
+template<class Type>
+void ArcLengthSplineT<Type>::Reserve(int ptCnt)
+{
+	m_Bezier.Reserve(ptCnt);
+	m_Ctrl.reserve(4 * ptCnt);
+	m_SegEnds.reserve(ptCnt);
+}
+
+template<class Type>
+typename ArcLengthSplineT<Type>::Vec3 ArcLengthSplineT<Type>::Evaluate(Type s) const
+{
+	if (m_SegEnds.empty())
+		return Vec3();
+
+	s = std::max((Type)0, std::min(s, GetLength()));
+
+	int seg = std::lower_bound(m_SegEnds.begin(), m_SegEnds.end(), s) - m_SegEnds.begin();
+	seg = std::min(seg, (int)m_SegEnds.size() - 1);
+
+	Type segStart = (seg == 0) ? (Type)0 : m_SegEnds[seg - 1];
+	return EvaluateSegment(&m_Ctrl[4 * seg], segStart, m_SegEnds[seg], s);
+}
+
+template<class Type>
+Type ArcLengthSplineT<Type>::GetSegmentLength(const Vec3* ctrl)
+{
+	return SegmentLength(ctrl, (Type)1);
+}
+
+template<class Type>
+typename ArcLengthSplineT<Type>::Vec3 ArcLengthSplineT<Type>::EvaluateSegment(const Vec3* ctrl, Type start, Type end, Type s)
+{
+	Type segLen = end - start;
+	Type target = s - start;
+	if (segLen <= 0)
+		return SegmentPoint(ctrl, (Type)0);
+
+	// Newton on length(t) - target, speed is the derivative. The linear
+	// guess is close since segments are short and smooth.
+	Type t = target / segLen;
+	for (int i = 0; i < 8; ++i)
+	{
+		Type err = SegmentLength(ctrl, t) - target;
+		if (std::fabs(err) <= (Type)1e-6f * segLen)
+			break;
+		Type speed = iv::length(SegmentTangent(ctrl, t));
+		if (speed <= (Type)1e-12f)
+			break;
+		t = std::max((Type)0, std::min((Type)1, t - err / speed));
+	}
+
+	return SegmentPoint(ctrl, t);
+}
+
+template<class Type>
+void ArcLengthSplineT<Type>::SampleUniform(int partCnt, std::vector<Vec3>& o_pts) const
+{
+	o_pts.clear();
+	if (m_SegEnds.empty() || partCnt <= 0)
+		return;
+
+	Type len = GetLength();
+	o_pts.resize(partCnt + 1);
+	for (int i = 0; i <= partCnt; ++i)
+		o_pts[i] = Evaluate(len * (Type)i / (Type)partCnt);
+}
+
+template<class Type>
+void ArcLengthSplineT<Type>::SampleSpacing(Type spacing, std::vector<Vec3>& o_pts) const
+{
+	o_pts.clear();
+	if (m_SegEnds.empty() || spacing <= 0)
+		return;
+
+	int cnt = (int)(GetLength() / spacing) + 1;
+	o_pts.resize(cnt);
+	for (int i = 0; i < cnt; ++i)
+		o_pts[i] = Evaluate(spacing * (Type)i);
+}
+
+template<class Type>
+Type ArcLengthSplineT<Type>::SegmentLength(const Vec3* ctrl, Type t)
+{
+	Type half = (Type)0.5 * t;
+	Type sum = 0;
+	for (int i = 0; i < 5; ++i)
+		sum += Gauss<Type>::W[i] * iv::length(SegmentTangent(ctrl, half * (Gauss<Type>::X[i] + (Type)1)));
+	return half * sum;
+}
+
+template<class Type>
+typename ArcLengthSplineT<Type>::Vec3 ArcLengthSplineT<Type>::SegmentPoint(const Vec3* p, Type t)
+{
+	Type u = (Type)1 - t;
+	return p[0] * (u * u * u) + p[1] * ((Type)3 * u * u * t) + p[2] * ((Type)3 * u * t * t) + p[3] * (t * t * t);
+}
+
+template<class Type>
+typename ArcLengthSplineT<Type>::Vec3 ArcLengthSplineT<Type>::SegmentTangent(const Vec3* p, Type t)
+{
+	Type u = (Type)1 - t;
+	return (p[1] - p[0]) * ((Type)3 * u * u) + (p[2] - p[1]) * ((Type)6 * u * t) + (p[3] - p[2]) * ((Type)3 * t * t);
+}
+
+template class ArcLengthSplineT<float>;
+template class ArcLengthSplineT<double>;
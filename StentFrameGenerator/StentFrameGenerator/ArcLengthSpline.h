@@ -0,0 +1,71 @@
+#pragma once
+
+#include "SiMath.h"
+#include "BeizerSpline.h"
+#include <vector>
+
+/* example */
+/*
+	ArcLengthSpline spline;
+	spline.Build(pts);
+	vector<vec3> rings;
+	spline.SampleUniform(10, rings);	// 11 points, equal arc length apart
+*/
+
+// The Beizer spline of BeizerSplineGenerator parameterized by arc length.
+// Build keeps one length entry per segment, lookups binary-search the
+// segment and solve for t with Newton steps, so placing a point costs the
+// same no matter how densely the spline would be sampled.
+// Type: scalar of points and lengths, float or double.
+template<class Type>
+class ArcLengthSplineT
+{
+public:
+	typedef iv::Vector3<Type> Vec3;
+
+	ArcLengthSplineT();
+
+	// i_pts: center-line points, fewer than 3 gives an empty spline.
+	void Build(const std::vector<Vec3>& i_pts);
+	void Build(const Vec3* i_pts, int ptCnt);
+
+	// Grows internal buffers for inputs of up to ptCnt points.
+	void Reserve(int ptCnt);
+
+	bool IsEmpty() const { return m_SegEnds.empty(); }
+
+	Type GetLength() const { return m_SegEnds.empty() ? (Type)0 : m_SegEnds.back(); }
+
+	// Point at arc length s from the start, s is clamped to [0, GetLength()].
+	Vec3 Evaluate(Type s) const;
+
+	// partCnt + 1 points splitting the spline into partCnt equal lengths.
+	void SampleUniform(int partCnt, std::vector<Vec3>& o_pts) const;
+
+	// Points at 0, spacing, 2 * spacing, ... up to the spline length.
+	void SampleSpacing(Type spacing, std::vector<Vec3>& o_pts) const;
+
+	// The per-segment steps of Build and Evaluate, for callers that see
+	// the segments one at a time, e.g. a streamed center-line.
+	// ctrl: four control points, see BeizerSplineGenerator::CreateSegments.
+	static Type GetSegmentLength(const Vec3* ctrl);
+	// Point at arc length s of a segment that spans start .. end of the
+	// spline, start <= s <= end.
+	static Vec3 EvaluateSegment(const Vec3* ctrl, Type start, Type end, Type s);
+
+private:
+	// Length of the segment from t = 0 to t.
+	static Type SegmentLength(const Vec3* ctrl, Type t);
+	static Vec3 SegmentPoint(const Vec3* p, Type t);
+	static Vec3 SegmentTangent(const Vec3* p, Type t);
+
+private:
+	BeizerSplineGeneratorT<Type> m_Bezier;
+	// Four control points per segment.
+	std::vector<Vec3> m_Ctrl;
+	// m_SegEnds[i]: arc length at the end of segment i.
+	std::vector<Type> m_SegEnds;
+};
+
+typedef ArcLengthSplineT<float> ArcLengthSpline;
+typedef ArcLengthSplineT<double> ArcLengthSplineD;
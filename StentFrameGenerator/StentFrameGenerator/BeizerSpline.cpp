@@ -1,60 +1,341 @@
 #include "BeizerSpline.h"
 
-BeizerSplineGenerator::BeizerSplineGenerator(float step) : m_Step(step)
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Halvings per segment before a piece is taken as is. 2^-16 of a
+	// segment is far below any useful tolerance.
+	const int s_MaxDepth = 16;
+
+	// Distance of p from the segment a b, or from a if they meet.
+	template<class Type>
+	Type DistanceToSegment(const iv::Vector3<Type>& p, const iv::Vector3<Type>& a, const iv::Vector3<Type>& b)
+	{
+		iv::Vector3<Type> ab = b - a;
+		iv::Vector3<Type> ap = p - a;
+		Type len2 = iv::dot(ab, ab);
+		if (len2 <= (Type)1e-30f)
+			return iv::length(ap);
+		Type u = std::max((Type)0, std::min((Type)1, iv::dot(ap, ab) / len2));
+		return iv::length(ap - ab * u);
+	}
+}
+
+template<class Type>
+BeizerSplineGeneratorT<Type>::BeizerSplineGeneratorT(float step, EvalMode mode) : m_Step(step)
+	,m_Mode(mode)
 {
 }
 
-void BeizerSplineGenerator::CreateBeizeSpline(const std::vector<iv::vec3>& i_pts, std::vector<iv::vec3>& o_pts)
+template<class Type>
+bool BeizerSplineGeneratorT<Type>::IsValidStep(float step)
+{
+	return step >= 1.0f / MaxSegmentSampleCnt;
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::GetInnerCtrlPts(const Vec3* i_pts, int ptCnt, int i, Vec3& o_before, Vec3& o_after)
+{
+	using namespace iv;
+
+	Vec3 prev = (i == 0) ? i_pts[i] : i_pts[i - 1];
+	Vec3 p = i_pts[i];
+	Vec3 next = (i == (ptCnt - 1)) ? i_pts[i]: i_pts[i + 1];
+
+	Vec3 mid_prev = (prev + p) * (Type)0.5;
+	Vec3 mid_next = (next + p) * (Type)0.5;
+
+	Vec3 offset = (mid_next - mid_prev) * (Type)0.5;
+
+	o_before = p - offset;
+	o_after = p + offset;
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CacheMidpts(const Vec3* i_pts, int ptCnt)
 {
 	using namespace iv;
 
+	m_CachedMidpts.resize(2 * ptCnt);
+
+	for (int i = 0; i < ptCnt; ++i)
+		GetInnerCtrlPts(i_pts, ptCnt, i, m_CachedMidpts[2 * i], m_CachedMidpts[2 * i + 1]);
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateBeizeSpline(const std::vector<Vec3>& i_pts, std::vector<Vec3>& o_pts)
+{
 	if (i_pts.size() <= 2)
 		return;
 
-	m_CachedMidpts.clear();
-	
-	int ptCnt = i_pts.size();
+	CreateBeizeSpline(&i_pts[0], i_pts.size(), o_pts);
+}
 
-	for (int i = 0; i < ptCnt; ++i)
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateBeizeSpline(const std::vector<Vec3>& i_pts, Vec3* o_pts)
+{
+	if (i_pts.size() <= 2)
+		return;
+
+	CreateBeizeSpline(&i_pts[0], i_pts.size(), o_pts);
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateBeizeSpline(const Vec3* i_pts, int ptCnt, std::vector<Vec3>& o_pts)
+{
+	using namespace iv;
+
+	if (ptCnt <= 2)
+		return;
+
+	o_pts.resize(GetSplinePtCnt(ptCnt));
+	CreateBeizeSpline(i_pts, ptCnt, &o_pts[0]);
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateBeizeSpline(const Vec3* i_pts, int ptCnt, Vec3* o_pts)
+{
+	using namespace iv;
+
+	if (ptCnt <= 2)
+		return;
+
+	CacheMidpts(i_pts, ptCnt);
+
+	int segCnt = GetSegmentSampleCnt();
+
+	Vec3* out = o_pts;
+
+	for (int i = 0; i < ptCnt - 1; ++i)
 	{
-		vec3 prev = (i == 0) ? i_pts[i] : i_pts[i - 1];
-		vec3 p = i_pts[i];
-		vec3 next = (i == (ptCnt - 1)) ? i_pts[i]: i_pts[i + 1];
+		CreateSegment(i_pts[i], m_CachedMidpts[2 * i + 1], m_CachedMidpts[2 * (i + 1) + 0], i_pts[i + 1], segCnt, out);
+		out += segCnt;
+	}
+
+	*out = i_pts[ptCnt - 1];
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateSegment(const Vec3& p0, const Vec3& p1, const Vec3& p2, const Vec3& p3,
+	int segCnt, Vec3* o_pts) const
+{
+	using namespace iv;
 
-		vec3 mid_prev = (prev + p) * 0.5f;
-		vec3 mid_next = (next + p) * 0.5f;
+	Vec3* out = o_pts;
+
+	if (m_Mode == ForwardDifference)
+	{
+		// p(t) = a t^3 + b t^2 + c t + p0, stepped by h.
+		Type h = m_Step;
+		Vec3 a = p3 - p2 * (Type)3 + p1 * (Type)3 - p0;
+		Vec3 b = (p2 - p1 * (Type)2 + p0) * (Type)3;
+		Vec3 c = (p1 - p0) * (Type)3;
 
-		vec3 offset = (mid_next - mid_prev) * 0.5f;
+		Vec3 px = p0;
+		Vec3 d1 = a * (h * h * h) + b * (h * h) + c * h;
+		Vec3 d2 = a * ((Type)6 * h * h * h) + b * ((Type)2 * h * h);
+		Vec3 d3 = a * ((Type)6 * h * h * h);
 
-		m_CachedMidpts.push_back(p - offset);
-		m_CachedMidpts.push_back(p + offset);
+		for (int k = 0; k < segCnt; ++k)
+		{
+			*out++ = px;
+			px += d1;
+			d1 += d2;
+			d2 += d3;
+		}
+		return;
 	}
 
+	float t = 0.0f;
+
+	for (int k = 0; k < segCnt; ++k)
+	{
+		Type s = t;
+		Type c0 = ((Type)1 - s) * ((Type)1 - s) * ((Type)1 - s);
+		Type c1 = (Type)3 * ((Type)1 - s) * ((Type)1 - s) * s;
+		Type c2 = (Type)3 * ((Type)1 - s) * s * s;
+		Type c3 = s * s * s;
+
+		*out++ = p0 * c0 + p1 * c1 + p2 * c2 + p3 * c3;
+
+		t += m_Step;
+	}
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateAdaptiveSpline(const std::vector<Vec3>& i_pts, Type tolerance,
+	std::vector<Vec3>& o_pts, AdaptiveStats* o_stats)
+{
 	o_pts.clear();
+	Type maxError = 0;
+	if (i_pts.size() > 2)
+	{
+		int ptCnt = i_pts.size();
+		CacheMidpts(&i_pts[0], ptCnt);
 
+		for (int i = 0; i < ptCnt - 1; ++i)
+		{
+			Type err = CreateAdaptiveSegment(i_pts[i], m_CachedMidpts[2 * i + 1], m_CachedMidpts[2 * (i + 1) + 0], i_pts[i + 1],
+				tolerance, o_pts);
+			maxError = std::max(maxError, err);
+		}
+		o_pts.push_back(i_pts[ptCnt - 1]);
+	}
 
-	for (int i = 0; i < ptCnt - 1; ++i)
+	if (o_stats)
 	{
-		vec3 p0 = i_pts[i];
-		vec3 p1 = m_CachedMidpts[2 * i + 1];
-		vec3 p2 = m_CachedMidpts[2 * (i + 1) + 0];
-		vec3 p3 = i_pts[i + 1];
+		o_stats->PtCnt = o_pts.size();
+		o_stats->MaxError = maxError;
+	}
+}
 
-		float t = 0.0f;
+template<class Type>
+Type BeizerSplineGeneratorT<Type>::CreateAdaptiveSegment(const Vec3& p0, const Vec3& p1, const Vec3& p2, const Vec3& p3,
+	Type tolerance, std::vector<Vec3>& o_pts)
+{
+	using namespace iv;
 
-		while (t < 1.0f)
-		{
-			float c0 = (1.0f - t) * (1.0f - t) * (1.0f - t);
-			float c1 = 3.0f * (1.0f - t) * (1.0f - t) * t;
-			float c2 = 3.0f * (1.0f - t) * t * t;
-			float c3 = t * t * t;
+	struct Piece
+	{
+		Vec3 P[4];
+		int Depth;
+	};
 
-			vec3 px = p0 * c0 + p1 * c1 + p2 * c2 + p3 * c3;
-			o_pts.push_back(px);
+	// Depth first, left half on top, so pieces come off in curve order.
+	Piece stack[s_MaxDepth + 1];
+	int top = 0;
+	stack[0].P[0] = p0;
+	stack[0].P[1] = p1;
+	stack[0].P[2] = p2;
+	stack[0].P[3] = p3;
+	stack[0].Depth = 0;
 
-			t += m_Step;
+	Type maxError = 0;
+	while (top >= 0)
+	{
+		Piece piece = stack[top--];
+		const Vec3* p = piece.P;
+
+		// Moving p1 and p2 onto the chord segment moves every curve point by
+		// at most 3/4 of the larger move, the most their Bernstein weights
+		// sum to, and leaves a curve on the segment. So the curve stays this
+		// close to its chord, also where it overshoots the chord's ends.
+		Type err = (Type)0.75 * std::max(DistanceToSegment(p[1], p[0], p[3]), DistanceToSegment(p[2], p[0], p[3]));
+		if (err <= tolerance || piece.Depth == s_MaxDepth)
+		{
+			o_pts.push_back(p[0]);
+			maxError = std::max(maxError, err);
+			continue;
 		}
+
+		// de Casteljau at t = 0.5.
+		Vec3 p01 = (p[0] + p[1]) * (Type)0.5;
+		Vec3 p12 = (p[1] + p[2]) * (Type)0.5;
+		Vec3 p23 = (p[2] + p[3]) * (Type)0.5;
+		Vec3 p012 = (p01 + p12) * (Type)0.5;
+		Vec3 p123 = (p12 + p23) * (Type)0.5;
+		Vec3 mid = (p012 + p123) * (Type)0.5;
+
+		Piece& right = stack[++top];
+		right.P[0] = mid;
+		right.P[1] = p123;
+		right.P[2] = p23;
+		right.P[3] = p[3];
+		right.Depth = piece.Depth + 1;
+
+		Piece& left = stack[++top];
+		left.P[0] = p[0];
+		left.P[1] = p01;
+		left.P[2] = p012;
+		left.P[3] = mid;
+		left.Depth = piece.Depth + 1;
+	}
+	return maxError;
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::UpdateBeizeSpline(const std::vector<Vec3>& i_pts, int k, Vec3* io_pts, int& o_first, int& o_last) const
+{
+	using namespace iv;
+
+	int ptCnt = i_pts.size();
+	o_first = 0;
+	o_last = -1;
+	if (ptCnt <= 2 || k < 0 || k >= ptCnt)
+		return;
+
+	// Inner control points of point i depend on points i-1 .. i+1, so
+	// segments k-2 .. k+1 see the move.
+	int segFirst = std::max(0, k - 2);
+	int segLast = std::min(ptCnt - 2, k + 1);
+	int segCnt = GetSegmentSampleCnt();
+
+	Vec3 before, after, nextBefore, nextAfter;
+	GetInnerCtrlPts(&i_pts[0], ptCnt, segFirst, before, after);
+	for (int i = segFirst; i <= segLast; ++i)
+	{
+		GetInnerCtrlPts(&i_pts[0], ptCnt, i + 1, nextBefore, nextAfter);
+		CreateSegment(i_pts[i], after, nextBefore, i_pts[i + 1], segCnt, io_pts + i * segCnt);
+		after = nextAfter;
 	}
 
-	o_pts.push_back(i_pts[ptCnt - 1]);
+	o_first = segFirst * segCnt;
+	o_last = (segLast + 1) * segCnt - 1;
+	if (segLast == ptCnt - 2)
+		io_pts[++o_last] = i_pts[ptCnt - 1];
 }
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateSegments(const std::vector<Vec3>& i_pts, std::vector<Vec3>& o_ctrl)
+{
+	CreateSegments(i_pts.empty() ? 0 : &i_pts[0], i_pts.size(), o_ctrl);
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::CreateSegments(const Vec3* i_pts, int ptCnt, std::vector<Vec3>& o_ctrl)
+{
+	o_ctrl.clear();
+	if (ptCnt <= 2)
+		return;
+
+	CacheMidpts(i_pts, ptCnt);
+
+	o_ctrl.resize(4 * (ptCnt - 1));
+	for (int i = 0; i < ptCnt - 1; ++i)
+	{
+		o_ctrl[4 * i + 0] = i_pts[i];
+		o_ctrl[4 * i + 1] = m_CachedMidpts[2 * i + 1];
+		o_ctrl[4 * i + 2] = m_CachedMidpts[2 * (i + 1) + 0];
+		o_ctrl[4 * i + 3] = i_pts[i + 1];
+	}
+}
+
+template<class Type>
+void BeizerSplineGeneratorT<Type>::Reserve(int ptCnt)
+{
+	m_CachedMidpts.reserve(2 * ptCnt);
+}
+
+template<class Type>
+int BeizerSplineGeneratorT<Type>::GetSegmentSampleCnt() const
+{
+	// Same float accumulation as CreateBeizeSpline so the counts agree.
+	// Capped, a step below half an ulp of t would never reach 1.
+	int cnt = 0;
+	for (float t = 0.0f; t < 1.0f && cnt < MaxSegmentSampleCnt; t += m_Step)
+		++cnt;
+	return cnt;
+}
+
+template<class Type>
+int BeizerSplineGeneratorT<Type>::GetSplinePtCnt(int ptCnt) const
+{
+	if (ptCnt <= 2)
+		return 0;
+	return (ptCnt - 1) * GetSegmentSampleCnt() + 1;
+}
+
+template class BeizerSplineGeneratorT<float>;
+template class BeizerSplineGeneratorT<double>;
@@ -3,15 +3,107 @@
 #include "SiMath.h"
 #include <vector>
 
-class BeizerSplineGenerator
+// Type: scalar of the points, float or double. The t steps are the same
+// float sequence for both, so they emit the same sample count.
+template<class Type>
+class BeizerSplineGeneratorT
 {
 public:
-	explicit BeizerSplineGenerator(float step);
+	typedef iv::Vector3<Type> Vec3;
 
-	void CreateBeizeSpline(const std::vector<iv::vec3>& i_pts,
-		std::vector<iv::vec3>& o_pts);
+	enum EvalMode
+	{
+		// Bernstein weights evaluated at every t.
+		Bernstein,
+		// Power basis stepped with forward differences, three vector
+		// additions per sample.
+		ForwardDifference
+	};
+
+	// Result of CreateAdaptiveSpline.
+	struct AdaptiveStats
+	{
+		// Points emitted, the last input point included.
+		int PtCnt;
+		// Upper bound of the distance from any spline point to the emitted
+		// polyline. At most the requested tolerance, unless a piece reached
+		// the halving limit first.
+		Type MaxError;
+	};
+
+	// Most samples per segment. Smaller steps, down to ones that can't
+	// advance t at all, are sampled this many times.
+	static const int MaxSegmentSampleCnt = 1 << 16;
+
+	// step: t increment inside a segment.
+	explicit BeizerSplineGeneratorT(float step, EvalMode mode = Bernstein);
+
+	// Whether step is positive and gives at most MaxSegmentSampleCnt samples
+	// per segment, false for NaN.
+	static bool IsValidStep(float step);
+
+	void CreateBeizeSpline(const std::vector<Vec3>& i_pts,
+		std::vector<Vec3>& o_pts);
+
+	// Same, written to o_pts, which must hold GetSplinePtCnt(i_pts.size())
+	// points.
+	void CreateBeizeSpline(const std::vector<Vec3>& i_pts,
+		Vec3* o_pts);
+
+	// Same for ptCnt points at i_pts, e.g. a CenterlineReader mapping.
+	void CreateBeizeSpline(const Vec3* i_pts, int ptCnt,
+		std::vector<Vec3>& o_pts);
+	void CreateBeizeSpline(const Vec3* i_pts, int ptCnt,
+		Vec3* o_pts);
+
+	// Same spline, but each segment is halved only until its pieces are
+	// flat to within tolerance, so straight runs get few points and sharp
+	// bends many. Ignores the step. Points are not evenly spaced in t.
+	// tolerance: allowed distance between the polyline and the spline.
+	// o_stats: optional, point count and achieved error.
+	void CreateAdaptiveSpline(const std::vector<Vec3>& i_pts, Type tolerance,
+		std::vector<Vec3>& o_pts, AdaptiveStats* o_stats = 0);
+
+	// Recomputes the samples of the segments i_pts[k] touches after it
+	// moved. io_pts holds CreateBeizeSpline's output for the same point
+	// count, only o_first .. o_last are rewritten.
+	void UpdateBeizeSpline(const std::vector<Vec3>& i_pts, int k,
+		Vec3* io_pts, int& o_first, int& o_last) const;
+
+	// Control points of the cubic segments CreateBeizeSpline samples, four
+	// per segment: p0, p1, p2, p3. Empty for 2 or fewer input points.
+	void CreateSegments(const std::vector<Vec3>& i_pts,
+		std::vector<Vec3>& o_ctrl);
+	void CreateSegments(const Vec3* i_pts, int ptCnt,
+		std::vector<Vec3>& o_ctrl);
+
+	// Grows internal buffers for inputs of up to ptCnt points.
+	void Reserve(int ptCnt);
+
+	// Count of samples per segment, the t loop in CreateBeizeSpline.
+	int GetSegmentSampleCnt() const;
+
+	// Count of points CreateBeizeSpline emits for ptCnt input points.
+	int GetSplinePtCnt(int ptCnt) const;
 
 private:
-	std::vector<iv::vec3> m_CachedMidpts;
+	// Inner control points around i_pts[i], the p2 of the segment ending
+	// there and the p1 of the segment starting there.
+	static void GetInnerCtrlPts(const Vec3* i_pts, int ptCnt, int i, Vec3& o_before, Vec3& o_after);
+
+	void CacheMidpts(const Vec3* i_pts, int ptCnt);
+	void CreateSegment(const Vec3& p0, const Vec3& p1, const Vec3& p2, const Vec3& p3,
+		int segCnt, Vec3* o_pts) const;
+	// Appends the adaptive samples of one segment, p3 excluded.
+	// return: largest error bound of the accepted pieces.
+	static Type CreateAdaptiveSegment(const Vec3& p0, const Vec3& p1, const Vec3& p2, const Vec3& p3,
+		Type tolerance, std::vector<Vec3>& o_pts);
+
+private:
+	std::vector<Vec3> m_CachedMidpts;
 	float m_Step;
-};
\ No newline at end of file
+	EvalMode m_Mode;
+};
+
+typedef BeizerSplineGeneratorT<float> BeizerSplineGenerator;
+typedef BeizerSplineGeneratorT<double> BeizerSplineGeneratorD;
@@ -0,0 +1,334 @@
+#include "BeizerSplineBatch.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BEIZER_BATCH_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(BEIZER_BATCH_X86) && !defined(_MSC_VER)
+#define BEIZER_BATCH_AVX2 __attribute__((target("avx2")))
+#define BEIZER_BATCH_AVX512 __attribute__((target("avx512f")))
+#define BEIZER_BATCH_HAS_AVX512 1
+#else
+#define BEIZER_BATCH_AVX2
+#define BEIZER_BATCH_AVX512
+// AVX-512 intrinsics came with Visual Studio 2017 15.3.
+#if defined(BEIZER_BATCH_X86) && _MSC_VER >= 1911
+#define BEIZER_BATCH_HAS_AVX512 1
+#endif
+#endif
+
+namespace
+{
+	// Lanes of the widest path, the control point arrays are padded to it.
+	const int s_MaxLaneCnt = 16;
+
+	// Arguments shared by the kernels.
+	struct Batch
+	{
+		// p0.x .. p3.z, one array each.
+		const float* Ctrl[12];
+		const int* SegStarts;
+		int SegCnt;
+		// c0 .. c3 of every t step.
+		const float* Weights;
+		int SampleCnt;
+	};
+
+	// Writes the lanes of one t step that hold real segments.
+	void StoreLanes(const float* x, const float* y, const float* z, const int* segStarts, int laneCnt, int k, iv::vec3* o_pts)
+	{
+		for (int l = 0; l < laneCnt; ++l)
+			o_pts[segStarts[l] + k] = iv::vec3(x[l], y[l], z[l]);
+	}
+
+	// Same products and sums as p0 * c0 + p1 * c1 + p2 * c2 + p3 * c3 on
+	// vec3, one coordinate at a time.
+	void EvaluateScalar(const Batch& b, iv::vec3* o_pts)
+	{
+		const float* const* p = b.Ctrl;
+		for (int i = 0; i < b.SegCnt; ++i)
+		{
+			iv::vec3* out = o_pts + b.SegStarts[i];
+			for (int k = 0; k < b.SampleCnt; ++k)
+			{
+				const float* c = b.Weights + 4 * k;
+				float x = p[0][i] * c[0] + p[3][i] * c[1] + p[6][i] * c[2] + p[9][i] * c[3];
+				float y = p[1][i] * c[0] + p[4][i] * c[1] + p[7][i] * c[2] + p[10][i] * c[3];
+				float z = p[2][i] * c[0] + p[5][i] * c[1] + p[8][i] * c[2] + p[11][i] * c[3];
+				out[k] = iv::vec3(x, y, z);
+			}
+		}
+	}
+
+#ifdef BEIZER_BATCH_X86
+	BEIZER_BATCH_AVX2 __m256 Bernstein(const __m256* p, __m256 c0, __m256 c1, __m256 c2, __m256 c3)
+	{
+		__m256 r = _mm256_add_ps(_mm256_mul_ps(p[0], c0), _mm256_mul_ps(p[1], c1));
+		r = _mm256_add_ps(r, _mm256_mul_ps(p[2], c2));
+		return _mm256_add_ps(r, _mm256_mul_ps(p[3], c3));
+	}
+
+	BEIZER_BATCH_AVX2 void EvaluateAVX2(const Batch& b, iv::vec3* o_pts)
+	{
+		alignas(32) float x[8], y[8], z[8];
+		for (int i = 0; i < b.SegCnt; i += 8)
+		{
+			// px[j]: x of control point j in the 8 lanes, likewise y, z.
+			__m256 px[4], py[4], pz[4];
+			for (int j = 0; j < 4; ++j)
+			{
+				px[j] = _mm256_loadu_ps(b.Ctrl[3 * j + 0] + i);
+				py[j] = _mm256_loadu_ps(b.Ctrl[3 * j + 1] + i);
+				pz[j] = _mm256_loadu_ps(b.Ctrl[3 * j + 2] + i);
+			}
+			int laneCnt = std::min(8, b.SegCnt - i);
+
+			for (int k = 0; k < b.SampleCnt; ++k)
+			{
+				const float* c = b.Weights + 4 * k;
+				__m256 c0 = _mm256_broadcast_ss(c + 0);
+				__m256 c1 = _mm256_broadcast_ss(c + 1);
+				__m256 c2 = _mm256_broadcast_ss(c + 2);
+				__m256 c3 = _mm256_broadcast_ss(c + 3);
+				_mm256_store_ps(x, Bernstein(px, c0, c1, c2, c3));
+				_mm256_store_ps(y, Bernstein(py, c0, c1, c2, c3));
+				_mm256_store_ps(z, Bernstein(pz, c0, c1, c2, c3));
+				StoreLanes(x, y, z, b.SegStarts + i, laneCnt, k, o_pts);
+			}
+		}
+	}
+
+#ifdef BEIZER_BATCH_HAS_AVX512
+	BEIZER_BATCH_AVX512 __m512 Bernstein(const __m512* p, __m512 c0, __m512 c1, __m512 c2, __m512 c3)
+	{
+		__m512 r = _mm512_add_ps(_mm512_mul_ps(p[0], c0), _mm512_mul_ps(p[1], c1));
+		r = _mm512_add_ps(r, _mm512_mul_ps(p[2], c2));
+		return _mm512_add_ps(r, _mm512_mul_ps(p[3], c3));
+	}
+
+	BEIZER_BATCH_AVX512 void EvaluateAVX512(const Batch& b, iv::vec3* o_pts)
+	{
+		alignas(64) float x[16], y[16], z[16];
+		for (int i = 0; i < b.SegCnt; i += 16)
+		{
+			__m512 px[4], py[4], pz[4];
+			for (int j = 0; j < 4; ++j)
+			{
+				px[j] = _mm512_loadu_ps(b.Ctrl[3 * j + 0] + i);
+				py[j] = _mm512_loadu_ps(b.Ctrl[3 * j + 1] + i);
+				pz[j] = _mm512_loadu_ps(b.Ctrl[3 * j + 2] + i);
+			}
+			int laneCnt = std::min(16, b.SegCnt - i);
+
+			for (int k = 0; k < b.SampleCnt; ++k)
+			{
+				const float* c = b.Weights + 4 * k;
+				__m512 c0 = _mm512_set1_ps(c[0]);
+				__m512 c1 = _mm512_set1_ps(c[1]);
+				__m512 c2 = _mm512_set1_ps(c[2]);
+				__m512 c3 = _mm512_set1_ps(c[3]);
+				_mm512_store_ps(x, Bernstein(px, c0, c1, c2, c3));
+				_mm512_store_ps(y, Bernstein(py, c0, c1, c2, c3));
+				_mm512_store_ps(z, Bernstein(pz, c0, c1, c2, c3));
+				StoreLanes(x, y, z, b.SegStarts + i, laneCnt, k, o_pts);
+			}
+		}
+	}
+#endif
+
+	BeizerSplineBatch::Isa DetectIsa()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return BeizerSplineBatch::Scalar;
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx)
+			return BeizerSplineBatch::Scalar;
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		bool avx512 = (info[1] & (1 << 16)) != 0;
+		// The OS saves the ymm registers, and for AVX-512 the opmask and
+		// zmm registers too.
+		unsigned long long xcr0 = _xgetbv(0);
+#ifdef BEIZER_BATCH_HAS_AVX512
+		if (avx512 && (xcr0 & 0xe6) == 0xe6)
+			return BeizerSplineBatch::AVX512;
+#else
+		(void)avx512;
+#endif
+		if (avx2 && (xcr0 & 6) == 6)
+			return BeizerSplineBatch::AVX2;
+		return BeizerSplineBatch::Scalar;
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+			return BeizerSplineBatch::AVX512;
+		if (__builtin_cpu_supports("avx2"))
+			return BeizerSplineBatch::AVX2;
+		return BeizerSplineBatch::Scalar;
+#endif
+	}
+#endif
+
+	void EvaluateSegments(BeizerSplineBatch::Isa isa, const Batch& b, iv::vec3* o_pts)
+	{
+#ifdef BEIZER_BATCH_X86
+#ifdef BEIZER_BATCH_HAS_AVX512
+		if (isa == BeizerSplineBatch::AVX512)
+		{
+			EvaluateAVX512(b, o_pts);
+			return;
+		}
+#endif
+		if (isa >= BeizerSplineBatch::AVX2)
+		{
+			EvaluateAVX2(b, o_pts);
+			return;
+		}
+#endif
+		EvaluateScalar(b, o_pts);
+	}
+}
+
+BeizerSplineBatch::Isa BeizerSplineBatch::GetBestIsa()
+{
+#ifdef BEIZER_BATCH_X86
+	static const Isa s_Isa = DetectIsa();
+	return s_Isa;
+#else
+	return Scalar;
+#endif
+}
+
+const char* BeizerSplineBatch::GetIsaName(Isa isa)
+{
+	switch (isa)
+	{
+	case AVX2:
+		return "avx2";
+	case AVX512:
+		return "avx512";
+	default:
+		return "scalar";
+	}
+}
+
+BeizerSplineBatch::BeizerSplineBatch(float step) : m_Generator(step)
+	,m_SegCnt(0)
+	,m_PtCnt(0)
+{
+	// Same float t sequence and weights as BeizerSplineGenerator's
+	// Bernstein mode.
+	m_SampleCnt = m_Generator.GetSegmentSampleCnt();
+	m_Weights.resize(4 * m_SampleCnt);
+	float t = 0.0f;
+	for (int k = 0; k < m_SampleCnt; ++k)
+	{
+		float s = t;
+		m_Weights[4 * k + 0] = (1.0f - s) * (1.0f - s) * (1.0f - s);
+		m_Weights[4 * k + 1] = 3.0f * (1.0f - s) * (1.0f - s) * s;
+		m_Weights[4 * k + 2] = 3.0f * (1.0f - s) * s * s;
+		m_Weights[4 * k + 3] = s * s * s;
+		t += step;
+	}
+}
+
+int BeizerSplineBatch::AddCurve(const iv::vec3* i_pts, int ptCnt)
+{
+	int first = m_PtCnt;
+	if (ptCnt <= 2)
+		return first;
+
+	m_Generator.CreateSegments(i_pts, ptCnt, m_CurveCtrl);
+
+	int segCnt = ptCnt - 1;
+	int paddedCnt = (m_SegCnt + segCnt + s_MaxLaneCnt - 1) / s_MaxLaneCnt * s_MaxLaneCnt;
+	for (int j = 0; j < 12; ++j)
+		m_Ctrl[j].resize(paddedCnt, 0.0f);
+
+	for (int i = 0; i < segCnt; ++i)
+	{
+		const iv::vec3* ctrl = &m_CurveCtrl[4 * i];
+		for (int j = 0; j < 4; ++j)
+		{
+			m_Ctrl[3 * j + 0][m_SegCnt + i] = ctrl[j].x;
+			m_Ctrl[3 * j + 1][m_SegCnt + i] = ctrl[j].y;
+			m_Ctrl[3 * j + 2][m_SegCnt + i] = ctrl[j].z;
+		}
+		m_SegStarts.push_back(first + i * m_SampleCnt);
+	}
+	m_SegCnt += segCnt;
+
+	m_EndPts.push_back(i_pts[ptCnt - 1]);
+	m_EndStarts.push_back(first + segCnt * m_SampleCnt);
+	m_PtCnt = first + segCnt * m_SampleCnt + 1;
+	return first;
+}
+
+int BeizerSplineBatch::AddCurve(const std::vector<iv::vec3>& i_pts)
+{
+	return AddCurve(i_pts.empty() ? 0 : &i_pts[0], i_pts.size());
+}
+
+void BeizerSplineBatch::Clear()
+{
+	for (int j = 0; j < 12; ++j)
+		m_Ctrl[j].clear();
+	m_SegStarts.clear();
+	m_EndPts.clear();
+	m_EndStarts.clear();
+	m_SegCnt = 0;
+	m_PtCnt = 0;
+}
+
+void BeizerSplineBatch::Reserve(int segCnt)
+{
+	int paddedCnt = (segCnt + s_MaxLaneCnt - 1) / s_MaxLaneCnt * s_MaxLaneCnt;
+	for (int j = 0; j < 12; ++j)
+		m_Ctrl[j].reserve(paddedCnt);
+	m_SegStarts.reserve(segCnt);
+}
+
+int BeizerSplineBatch::GetSegmentCnt() const
+{
+	return m_SegCnt;
+}
+
+int BeizerSplineBatch::GetPtCnt() const
+{
+	return m_PtCnt;
+}
+
+void BeizerSplineBatch::Evaluate(iv::vec3* o_pts) const
+{
+	Evaluate(GetBestIsa(), o_pts);
+}
+
+void BeizerSplineBatch::Evaluate(Isa isa, iv::vec3* o_pts) const
+{
+	if (m_SegCnt > 0)
+	{
+		Batch b;
+		for (int j = 0; j < 12; ++j)
+			b.Ctrl[j] = &m_Ctrl[j][0];
+		b.SegStarts = &m_SegStarts[0];
+		b.SegCnt = m_SegCnt;
+		b.Weights = &m_Weights[0];
+		b.SampleCnt = m_SampleCnt;
+
+		EvaluateSegments(isa, b, o_pts);
+	}
+
+	for (size_t i = 0; i < m_EndPts.size(); ++i)
+		o_pts[m_EndStarts[i]] = m_EndPts[i];
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "BeizerSpline.h"
+#include <vector>
+
+/* example */
+/*
+	BeizerSplineBatch batch(0.1f);
+	for (int i = 0; i < branchCnt; ++i)
+		starts[i] = batch.AddCurve(&branches[i][0], branches[i].size());
+
+	std::vector<iv::vec3> out(batch.GetPtCnt());
+	batch.Evaluate(&out[0]);
+	// Branch i is at out[starts[i]], BeizerSplineGenerator::GetSplinePtCnt
+	// points, the same floats CreateBeizeSpline gives for it.
+*/
+
+// Samples the Bezier segments of many center-lines together. Control
+// points come from BeizerSplineGenerator::CreateSegments and are kept one
+// array per coordinate, so a SIMD lane evaluates one segment: 8 per
+// instruction with AVX2, 16 with AVX-512. Segments of all curves share the
+// lanes, which pays off for many short branches where a curve alone fills
+// few of them.
+// All paths evaluate the Bernstein mode of CreateBeizeSpline in the same
+// order, so they give the same floats as it does.
+class BeizerSplineBatch
+{
+public:
+	enum Isa
+	{
+		Scalar,
+		AVX2,
+		AVX512
+	};
+
+	// Widest instruction set this CPU, OS and compiler support, detected
+	// once.
+	static Isa GetBestIsa();
+
+	static const char* GetIsaName(Isa isa);
+
+	// step: t increment inside a segment, as for BeizerSplineGenerator.
+	explicit BeizerSplineBatch(float step);
+
+	// Adds the spline through ptCnt points. Curves of 2 or fewer points
+	// add nothing, like CreateBeizeSpline.
+	// return: index of the curve's first point in Evaluate's output.
+	int AddCurve(const iv::vec3* i_pts, int ptCnt);
+	int AddCurve(const std::vector<iv::vec3>& i_pts);
+
+	// Drops all curves, keeps the capacity.
+	void Clear();
+
+	// Grows internal buffers for segCnt segments in total.
+	void Reserve(int segCnt);
+
+	int GetSegmentCnt() const;
+
+	// Count of points Evaluate writes, GetSplinePtCnt summed over curves.
+	int GetPtCnt() const;
+
+	// o_pts: GetPtCnt() points, the curves in the order they were added.
+	void Evaluate(iv::vec3* o_pts) const;
+
+	// Same with an explicit instruction set, isa must not exceed
+	// GetBestIsa().
+	void Evaluate(Isa isa, iv::vec3* o_pts) const;
+
+private:
+	BeizerSplineGenerator m_Generator;
+	int m_SampleCnt;
+	// Bernstein weights c0 .. c3 of every t step.
+	std::vector<float> m_Weights;
+
+	int m_SegCnt;
+	int m_PtCnt;
+	// p0.x, p0.y, p0.z, p1.x, .. p3.z of every segment, padded with zero
+	// segments to a multiple of the widest lane count.
+	std::vector<float> m_Ctrl[12];
+	// Output index of each segment's first sample.
+	std::vector<int> m_SegStarts;
+	// Last input point of each curve and where it goes.
+	std::vector<iv::vec3> m_EndPts;
+	std::vector<int> m_EndStarts;
+	// CreateSegments output of the curve being added.
+	std::vector<iv::vec3> m_CurveCtrl;
+};
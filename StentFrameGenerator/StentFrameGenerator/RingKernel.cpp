@@ -0,0 +1,200 @@
+#include "RingKernel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RING_KERNEL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(RING_KERNEL_X86) && !defined(_MSC_VER)
+#define RING_KERNEL_AVX2 __attribute__((target("avx2")))
+#else
+#define RING_KERNEL_AVX2
+#endif
+
+static_assert(sizeof(iv::vec3) == 3 * sizeof(float), "points are stored as packed x, y, z");
+
+namespace
+{
+	void TransformScalar(const float* lx, const float* ly, const float* lz, int begin, int cnt,
+		const iv::vec3& o, const iv::vec3& vx, const iv::vec3& vy, const iv::vec3& vz, iv::vec3* o_pts)
+	{
+		for (int i = begin; i < cnt; ++i)
+			o_pts[i] = o + vx * lx[i] + vy * ly[i] + vz * lz[i];
+	}
+
+#ifdef RING_KERNEL_X86
+	// Interleaves 4 x, y and z values into x0 y0 z0 x1 | y1 z1 x2 y2 |
+	// z2 x3 y3 z3, or the same within each 128-bit lane of a __m256.
+	// Shuffles only, the floats are stored as computed.
+	void InterleaveXyz(__m128 x, __m128 y, __m128 z, __m128& o_a, __m128& o_b, __m128& o_c)
+	{
+		__m128 xy0 = _mm_unpacklo_ps(x, y);
+		__m128 xy1 = _mm_unpackhi_ps(x, y);
+		o_a = _mm_shuffle_ps(xy0, _mm_shuffle_ps(z, xy0, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+		o_b = _mm_shuffle_ps(_mm_shuffle_ps(xy0, z, _MM_SHUFFLE(1, 1, 3, 3)), xy1, _MM_SHUFFLE(1, 0, 2, 0));
+		o_c = _mm_shuffle_ps(_mm_shuffle_ps(z, xy1, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_ps(xy1, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	}
+
+	RING_KERNEL_AVX2 void InterleaveXyz(__m256 x, __m256 y, __m256 z, __m256& o_a, __m256& o_b, __m256& o_c)
+	{
+		__m256 xy0 = _mm256_unpacklo_ps(x, y);
+		__m256 xy1 = _mm256_unpackhi_ps(x, y);
+		o_a = _mm256_shuffle_ps(xy0, _mm256_shuffle_ps(z, xy0, _MM_SHUFFLE(2, 2, 0, 0)), _MM_SHUFFLE(2, 0, 1, 0));
+		o_b = _mm256_shuffle_ps(_mm256_shuffle_ps(xy0, z, _MM_SHUFFLE(1, 1, 3, 3)), xy1, _MM_SHUFFLE(1, 0, 2, 0));
+		o_c = _mm256_shuffle_ps(_mm256_shuffle_ps(z, xy1, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_shuffle_ps(xy1, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+	}
+
+	void TransformSSE(const float* lx, const float* ly, const float* lz, int cnt,
+		const iv::vec3& o, const iv::vec3& vx, const iv::vec3& vy, const iv::vec3& vz, iv::vec3* o_pts)
+	{
+		__m128 o_[3], x_[3], y_[3], z_[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			o_[c] = _mm_set1_ps(o.v[c]);
+			x_[c] = _mm_set1_ps(vx.v[c]);
+			y_[c] = _mm_set1_ps(vy.v[c]);
+			z_[c] = _mm_set1_ps(vz.v[c]);
+		}
+
+		int i = 0;
+		for (; i + 4 <= cnt; i += 4)
+		{
+			__m128 px = _mm_loadu_ps(lx + i);
+			__m128 py = _mm_loadu_ps(ly + i);
+			__m128 pz = _mm_loadu_ps(lz + i);
+
+			__m128 r[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				r[c] = _mm_add_ps(o_[c], _mm_mul_ps(x_[c], px));
+				r[c] = _mm_add_ps(r[c], _mm_mul_ps(y_[c], py));
+				r[c] = _mm_add_ps(r[c], _mm_mul_ps(z_[c], pz));
+			}
+
+			__m128 a, b, d;
+			InterleaveXyz(r[0], r[1], r[2], a, b, d);
+			float* dst = o_pts[i].v;
+			_mm_storeu_ps(dst, a);
+			_mm_storeu_ps(dst + 4, b);
+			_mm_storeu_ps(dst + 8, d);
+		}
+
+		TransformScalar(lx, ly, lz, i, cnt, o, vx, vy, vz, o_pts);
+	}
+
+	RING_KERNEL_AVX2 void TransformAVX2(const float* lx, const float* ly, const float* lz, int cnt,
+		const iv::vec3& o, const iv::vec3& vx, const iv::vec3& vy, const iv::vec3& vz, iv::vec3* o_pts)
+	{
+		__m256 o_[3], x_[3], y_[3], z_[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			o_[c] = _mm256_set1_ps(o.v[c]);
+			x_[c] = _mm256_set1_ps(vx.v[c]);
+			y_[c] = _mm256_set1_ps(vy.v[c]);
+			z_[c] = _mm256_set1_ps(vz.v[c]);
+		}
+
+		int i = 0;
+		for (; i + 8 <= cnt; i += 8)
+		{
+			__m256 px = _mm256_loadu_ps(lx + i);
+			__m256 py = _mm256_loadu_ps(ly + i);
+			__m256 pz = _mm256_loadu_ps(lz + i);
+
+			__m256 r[3];
+			for (int c = 0; c < 3; ++c)
+			{
+				r[c] = _mm256_add_ps(o_[c], _mm256_mul_ps(x_[c], px));
+				r[c] = _mm256_add_ps(r[c], _mm256_mul_ps(y_[c], py));
+				r[c] = _mm256_add_ps(r[c], _mm256_mul_ps(z_[c], pz));
+			}
+
+			// Lanes hold points 0-3 and 4-7, each interleaved on its own.
+			__m256 a, b, d;
+			InterleaveXyz(r[0], r[1], r[2], a, b, d);
+			float* dst = o_pts[i].v;
+			_mm256_storeu_ps(dst, _mm256_permute2f128_ps(a, b, 0x20));
+			_mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(d, a, 0x30));
+			_mm256_storeu_ps(dst + 16, _mm256_permute2f128_ps(b, d, 0x31));
+		}
+
+		TransformScalar(lx, ly, lz, i, cnt, o, vx, vy, vz, o_pts);
+	}
+
+	RingKernel::Isa DetectIsa()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+			if (osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6)
+				return RingKernel::AVX2;
+		}
+		return RingKernel::SSE;
+#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return RingKernel::AVX2;
+		if (__builtin_cpu_supports("sse2"))
+			return RingKernel::SSE;
+		return RingKernel::Scalar;
+#endif
+	}
+#endif
+}
+
+RingKernel::Isa RingKernel::GetBestIsa()
+{
+#ifdef RING_KERNEL_X86
+	static const Isa s_Isa = DetectIsa();
+	return s_Isa;
+#else
+	return Scalar;
+#endif
+}
+
+const char* RingKernel::GetIsaName(Isa isa)
+{
+	switch (isa)
+	{
+	case SSE:
+		return "sse";
+	case AVX2:
+		return "avx2";
+	default:
+		return "scalar";
+	}
+}
+
+void RingKernel::Transform(const float* lx, const float* ly, const float* lz, int cnt,
+	const iv::vec3& o, const iv::vec3& vx, const iv::vec3& vy, const iv::vec3& vz, iv::vec3* o_pts)
+{
+	Transform(GetBestIsa(), lx, ly, lz, cnt, o, vx, vy, vz, o_pts);
+}
+
+void RingKernel::Transform(Isa isa, const float* lx, const float* ly, const float* lz, int cnt,
+	const iv::vec3& o, const iv::vec3& vx, const iv::vec3& vy, const iv::vec3& vz, iv::vec3* o_pts)
+{
+#ifdef RING_KERNEL_X86
+	if (isa == AVX2)
+	{
+		TransformAVX2(lx, ly, lz, cnt, o, vx, vy, vz, o_pts);
+		return;
+	}
+	if (isa == SSE)
+	{
+		TransformSSE(lx, ly, lz, cnt, o, vx, vy, vz, o_pts);
+		return;
+	}
+#endif
+	TransformScalar(lx, ly, lz, 0, cnt, o, vx, vy, vz, o_pts);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "SiMath.h"
+
+/* example */
+/*
+	// lx, ly, lz: local ring in N/T/B coordinates.
+	RingKernel::Transform(lx, ly, lz, cnt, tnb.O, tnb.N, tnb.T, tnb.B, out);
+*/
+
+// Maps local ring points into world space: o + vx * x + vy * y + vz * z.
+// The SIMD paths evaluate the same expression in the same order as the
+// scalar one, so all paths give the same floats.
+class RingKernel
+{
+public:
+	enum Isa
+	{
+		Scalar,
+		SSE,
+		AVX2
+	};
+
+	// Widest instruction set this CPU and OS support, detected once.
+	static Isa GetBestIsa();
+
+	static const char* GetIsaName(Isa isa);
+
+	// lx, ly, lz: local coordinates, cnt entries each.
+	// o_pts: cnt output points.
+	static void Transform(const float* lx, const float* ly, const float* lz, int cnt,
+		const iv::vec3& o, const iv::vec3& vx, const iv::vec3& vy, const iv::vec3& vz, iv::vec3* o_pts);
+
+	// Same with an explicit instruction set, isa must not exceed GetBestIsa().
+	static void Transform(Isa isa, const float* lx, const float* ly, const float* lz, int cnt,
+		const iv::vec3& o, const iv::vec3& vx, const iv::vec3& vy, const iv::vec3& vz, iv::vec3* o_pts);
+};
@@ -0,0 +1,38 @@
+#include "RingTemplate.h"
+#include "SharedCache.h"
+
+#include <tuple>
+
+namespace
+{
+	typedef SharedCache<std::tuple<int, int, float, float>, RingTemplate> TemplateCache;
+}
+
+RingTemplate::RingTemplate(int sampleCnt, int periodCnt, float xzScale, float yScale,
+	const float* sins, const float* sins2, const float* coss2)
+{
+	int total = sampleCnt * periodCnt;
+	m_X.resize(total);
+	m_Y.resize(total);
+	m_Z.resize(total);
+	for (int i = 0; i < total; ++i)
+	{
+		m_X[i] = xzScale * sins2[i];
+		m_Y[i] = yScale * sins[i % sampleCnt];
+		m_Z[i] = xzScale * coss2[i];
+	}
+}
+
+std::shared_ptr<const RingTemplate> RingTemplate::Acquire(int sampleCnt, int periodCnt, float xzScale, float yScale,
+	const float* sins, const float* sins2, const float* coss2)
+{
+	return TemplateCache::Get().Acquire(std::make_tuple(sampleCnt, periodCnt, xzScale, yScale), [&]
+	{
+		return std::make_shared<const RingTemplate>(sampleCnt, periodCnt, xzScale, yScale, sins, sins2, coss2);
+	});
+}
+
+void RingTemplate::Purge()
+{
+	TemplateCache::Get().Purge();
+}
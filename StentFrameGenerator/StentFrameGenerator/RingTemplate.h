@@ -0,0 +1,36 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+// Local-space ring of one stent design, in N/T/B coordinates of a frame.
+// x/z wind once around the vessel and y carries the periodCnt sin waves.
+// Only the frame transform differs between rings, so one template serves
+// every ring of every generator with the same parameters.
+class RingTemplate
+{
+public:
+	// Shared, immutable template of a configuration. Built on first request
+	// and kept cached after its last generator is gone. Thread-safe.
+	// sins: sampleCnt entries of sin over one period.
+	// sins2, coss2: sampleCnt * periodCnt entries of sin/cos over 2PI.
+	static std::shared_ptr<const RingTemplate> Acquire(int sampleCnt, int periodCnt, float xzScale, float yScale,
+		const float* sins, const float* sins2, const float* coss2);
+
+	// Drops the cached templates no generator holds.
+	static void Purge();
+
+	int GetPtCnt() const { return (int)m_X.size(); }
+
+	const float* GetX() const { return &m_X[0]; }
+	const float* GetY() const { return &m_Y[0]; }
+	const float* GetZ() const { return &m_Z[0]; }
+
+	RingTemplate(int sampleCnt, int periodCnt, float xzScale, float yScale,
+		const float* sins, const float* sins2, const float* coss2);
+
+private:
+	std::vector<float> m_X;
+	std::vector<float> m_Y;
+	std::vector<float> m_Z;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+/* example */
+/*
+	std::shared_ptr<const Table> table = SharedCache<Key, Table>::Get().Acquire(key, [&]
+	{
+		return std::make_shared<const Table>(...);
+	});
+*/
+
+// Immutable values shared by key, e.g. the tables of one stent design. A
+// value stays cached after its last user is gone, so a generator built per
+// request finds its tables even when no other one is alive. Thread-safe.
+template<class Key, class Value>
+class SharedCache
+{
+public:
+	// Values no one holds are dropped once the cache grows past this.
+	static const int MaxCnt = 64;
+
+	// The cache of this key and value type. A function static, so it is
+	// ready for generators constructed during static initialization.
+	static SharedCache& Get()
+	{
+		static SharedCache s_Cache;
+		return s_Cache;
+	}
+
+	// make: builds the value of key if it isn't cached, called under the
+	// lock.
+	template<class Make>
+	std::shared_ptr<const Value> Acquire(const Key& key, Make make)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		typename Map::iterator it = m_Values.find(key);
+		if (it != m_Values.end())
+			return it->second;
+
+		if ((int)m_Values.size() >= MaxCnt)
+			PurgeLocked();
+		std::shared_ptr<const Value> value = make();
+		m_Values[key] = value;
+		return value;
+	}
+
+	// Drops the values no one but the cache holds.
+	void Purge()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		PurgeLocked();
+	}
+
+private:
+	typedef std::map<Key, std::shared_ptr<const Value>> Map;
+
+	void PurgeLocked()
+	{
+		for (typename Map::iterator it = m_Values.begin(); it != m_Values.end();)
+		{
+			if (it->second.use_count() == 1)
+				it = m_Values.erase(it);
+			else
+				++it;
+		}
+	}
+
+private:
+	std::mutex m_Mutex;
+	Map m_Values;
+};
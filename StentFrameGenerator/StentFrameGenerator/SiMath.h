@@ -4,6 +4,7 @@
 #include <math.h>
 #include <iostream>
 #include <assert.h>
+#include <string.h>
 
 namespace iv
 {
@@ -87,10 +88,10 @@ namespace iv
 			return *this;
 		}
 
-		template<class Type> friend Vector2<Type> operator + (const Vector2<Type>& r1, const Vector2<Type>& r2);
-		template<class Type> friend Vector2<Type> operator - (const Vector2<Type>& r1, const Vector2<Type>& r2);
-		template<class Type> friend Vector2<Type> operator * (const Vector2<Type>& r1, const Type& v);
-		template<class Type> friend Vector2<Type> operator / (const Vector2<Type>& r1, const Type& v);
+		template<class U> friend Vector2<U> operator + (const Vector2<U>& r1, const Vector2<U>& r2);
+		template<class U> friend Vector2<U> operator - (const Vector2<U>& r1, const Vector2<U>& r2);
+		template<class U> friend Vector2<U> operator * (const Vector2<U>& r1, const U& v);
+		template<class U> friend Vector2<U> operator / (const Vector2<U>& r1, const U& v);
 
 			
 
@@ -114,7 +115,7 @@ namespace iv
 	template<class Type>
 	Vector2<Type> operator - (const Vector2<Type>& r1, const Vector2<Type>& r2)
 	{
-		return Vector2<Type>(r1.v[0] - r2.v[0], r1.v[1] - r2.v[1])
+		return Vector2<Type>(r1.v[0] - r2.v[0], r1.v[1] - r2.v[1]);
 	}
 	template<class Type>
 	Vector2<Type> operator * (const Vector2<Type>& r1, const Type& val)
@@ -124,7 +125,7 @@ namespace iv
 	template<class Type>
 	Vector2<Type> operator / (const Vector2<Type>& r1, const Type& val)
 	{
-		return Vector2<Type>(r1.v[0]/val,r1.v[1]/val)
+		return Vector2<Type>(r1.v[0]/val,r1.v[1]/val);
 	}
 
 	// Vector which has 3 components
@@ -205,10 +206,10 @@ namespace iv
 				v[i] -= refV3.v[i];
 			return *this;
 		}
-		Vector3& operator *= (const Type& v)
+		Vector3& operator *= (const Type& val)
 		{
 			for(int i = 0 ; i < 3 ; i++ )
-				v[i] *= refV3.v[i];
+				v[i] *= val;
 			return *this;
 		}
 		Vector3& operator /= (const Type& val)
@@ -230,29 +231,29 @@ namespace iv
 		}
 
 
-		template<class Type> friend Vector3<Type> operator + (const Vector3<Type>& r1, const Vector3<Type>& r2);
+		template<class U> friend Vector3<U> operator + (const Vector3<U>& r1, const Vector3<U>& r2);
 
-		template<class Type> friend Vector3<Type> operator - (const Vector3<Type>& r1, const Vector3<Type>& r2);
+		template<class U> friend Vector3<U> operator - (const Vector3<U>& r1, const Vector3<U>& r2);
 
-		template<class Type> friend Vector3<Type> operator * (const Vector3<Type>& r1, const Vector3<Type>& r2);
+		template<class U> friend Vector3<U> operator * (const Vector3<U>& r1, const Vector3<U>& r2);
 
-		template<class Type> friend Vector3<Type> operator * (const Vector3<Type>& r1, const Type& v);
+		template<class U> friend Vector3<U> operator * (const Vector3<U>& r1, const U& v);
 
-		template<class Type> friend Vector3<Type> operator / (const Vector3<Type>& r1, const Type& v);
+		template<class U> friend Vector3<U> operator / (const Vector3<U>& r1, const U& v);
 
-		template<class Type> friend Type length(const Vector3<Type>& refV);
+		template<class U> friend U length(const Vector3<U>& refV);
 
-		template<class Type> friend Type square(const Vector3<Type>& refV);
+		template<class U> friend U square(const Vector3<U>& refV);
 
-		template<class Type> friend Vector3<Type> normalize(const Vector3<Type>& refV);
+		template<class U> friend Vector3<U> normalize(const Vector3<U>& refV);
 
-		template<class Type> friend Vector3<Type> cross(const Vector3<Type>& r1, const Vector3<Type>& r2);
+		template<class U> friend Vector3<U> cross(const Vector3<U>& r1, const Vector3<U>& r2);
 
-		template<class Type> friend Type dot(const Vector3<Type>& r1, const Vector3<Type>& r2);
+		template<class U> friend U dot(const Vector3<U>& r1, const Vector3<U>& r2);
 
-		template<class Type> friend Type AngleRadian(const Vector3<Type>& ref1, const Vector3<Type>& ref2);
+		template<class U> friend U AngleRadian(const Vector3<U>& ref1, const Vector3<U>& ref2);
 
-		template<class Type> friend std::ostream& operator<<(std::ostream& os, const Vector3<Type>& refV3);
+		template<class U> friend std::ostream& operator<<(std::ostream& os, const Vector3<U>& refV3);
 
 	public:
 		union {
@@ -381,12 +382,12 @@ namespace iv
 
 		~Vector4(){}
 
-		template<class Type> friend Vector4<Type> operator + (const Vector4<Type>& lhs, const Vector4<Type> rhs);
-		template<class Type> friend Vector4<Type> operator - (const Vector4<Type>& lhs, const Vector4<Type> rhs);
-		template<class Type> friend Vector4<Type> operator * (const Vector4<Type>& lhs, const Type& val);
-		template<class Type> friend Vector4<Type> operator / (const Vector4<Type>& lhs, const Type& val);
-		template<class Type> friend std::ostream& operator<< (std::ostream& os, const Vector4<Type>& refV4);
-		template<class Type> friend Vector4<Type> operator * (const Matrix4<Type>& lhs, const Vector4<Type>& rhs);
+		template<class U> friend Vector4<U> operator + (const Vector4<U>& lhs, const Vector4<U> rhs);
+		template<class U> friend Vector4<U> operator - (const Vector4<U>& lhs, const Vector4<U> rhs);
+		template<class U> friend Vector4<U> operator * (const Vector4<U>& lhs, const U& val);
+		template<class U> friend Vector4<U> operator / (const Vector4<U>& lhs, const U& val);
+		template<class U> friend std::ostream& operator<< (std::ostream& os, const Vector4<U>& refV4);
+		template<class U> friend Vector4<U> operator * (const Matrix4<U>& lhs, const Vector4<U>& rhs);
 
 		Vector4& operator = (const Vector4& refV4)
 		{
@@ -604,16 +605,16 @@ namespace iv
 		}
 
 
-		template<class Type> friend Matrix3<Type> operator+ (const Matrix3<Type>& r1, const Matrix3<Type>& r2);
-		template<class Type> friend Matrix3<Type> operator- (const Matrix3<Type>& r1, const Matrix3<Type>& r2);
+		template<class U> friend Matrix3<U> operator+ (const Matrix3<U>& r1, const Matrix3<U>& r2);
+		template<class U> friend Matrix3<U> operator- (const Matrix3<U>& r1, const Matrix3<U>& r2);
 
-		template<class Type> friend Vector3<Type> operator* (const Matrix3<Type>& lhs, const Vector3<Type>& rhs);
-		template<class Type> friend Matrix3<Type> operator* (const Matrix3<Type>& r1, const Type& val);
-		template<class Type> friend Matrix3<Type> operator* (const Matrix3<Type>& r1, const Matrix3<Type>& r2);	
+		template<class U> friend Vector3<U> operator* (const Matrix3<U>& lhs, const Vector3<U>& rhs);
+		template<class U> friend Matrix3<U> operator* (const Matrix3<U>& r1, const U& val);
+		template<class U> friend Matrix3<U> operator* (const Matrix3<U>& r1, const Matrix3<U>& r2);	
 
-		template<class Type> friend Matrix3<Type> operator/ (const Matrix3<Type>& r1, const Type& val);
+		template<class U> friend Matrix3<U> operator/ (const Matrix3<U>& r1, const U& val);
 
-		template<class Type> friend std::ostream& operator<<(std::ostream& os, const Matrix3<Type>& refMat);
+		template<class U> friend std::ostream& operator<<(std::ostream& os, const Matrix3<U>& refMat);
 
 
 	public:
@@ -811,27 +812,27 @@ namespace iv
 		}
 
 
-		template<class Type> friend Matrix4<Type> operator+ (const Matrix4<Type>& r1, const Matrix4<Type>& r2);
-		template<class Type> friend Matrix4<Type> operator- (const Matrix4<Type>& r1, const Matrix4<Type>& r2);
+		template<class U> friend Matrix4<U> operator+ (const Matrix4<U>& r1, const Matrix4<U>& r2);
+		template<class U> friend Matrix4<U> operator- (const Matrix4<U>& r1, const Matrix4<U>& r2);
 
-		template<class Type> friend Vector4<Type> operator* (const Matrix4<Type>& lhs, const Vector4<Type>& rhs);
-		template<class Type> friend Matrix4<Type> operator* (const Matrix4<Type>& r1, const Type& val);
-		template<class Type> friend Matrix4<Type> operator* (const Matrix4<Type>& r1, const Matrix4<Type>& r2);	
+		template<class U> friend Vector4<U> operator* (const Matrix4<U>& lhs, const Vector4<U>& rhs);
+		template<class U> friend Matrix4<U> operator* (const Matrix4<U>& r1, const U& val);
+		template<class U> friend Matrix4<U> operator* (const Matrix4<U>& r1, const Matrix4<U>& r2);	
 
-		template<class Type> friend Matrix4<Type> operator/ (const Matrix4<Type>& r1, const Type& val);
+		template<class U> friend Matrix4<U> operator/ (const Matrix4<U>& r1, const U& val);
 
-		template<class Type> friend std::ostream& operator<<(std::ostream& os, const Matrix4<Type>& refMat);
+		template<class U> friend std::ostream& operator<<(std::ostream& os, const Matrix4<U>& refMat);
 
 
 
-		template<typename Type> friend Matrix4<Type> perspective(const Type& fovy, const Type& ratio, const Type& nearClip, const Type& farClip);
-		template<typename Type>friend Matrix4<Type> lookAt(const Vector3<Type>& eye, const Vector3<Type>& center, const Vector3<Type>& up);
-		template<class Type> friend Matrix4<Type> translate(const Vector3<Type>& trans);
-		template<class Type> friend Matrix4<Type> rotate(const Type& radian, const Vector3<Type>& axis);
-		template<class Type> friend Matrix4<Type> translate(Type x,Type y, Type z);
-		template<class Type> friend Matrix4<Type> scale(const Type& s);
-		template<class Type> friend Matrix4<Type> scale(const Vector3<Type>& n, const Type& k);
-		template<class Type> friend Matrix4<Type> viewport(const Type& x, const Type& y, const Type& width, const Type& height);
+		template<typename U> friend Matrix4<U> perspective(const U& fovy, const U& ratio, const U& nearClip, const U& farClip);
+		template<typename U> friend Matrix4<U> lookAt(const Vector3<U>& eye, const Vector3<U>& center, const Vector3<U>& up);
+		template<class U> friend Matrix4<U> translate(const Vector3<U>& trans);
+		template<class U> friend Matrix4<U> rotate(const U& radian, const Vector3<U>& axis);
+		template<class U> friend Matrix4<U> translate(U x,U y, U z);
+		template<class U> friend Matrix4<U> scale(const U& s);
+		template<class U> friend Matrix4<U> scale(const Vector3<U>& n, const U& k);
+		template<class U> friend Matrix4<U> viewport(const U& x, const U& y, const U& width, const U& height);
 
 
 		void identify(void)
@@ -958,16 +959,16 @@ namespace iv
 		Type m[16];
 		for (int i = 0; i < 16; i++)
 			m[i] = r1.v[i] * val;
-		return Matrix4(m);
+		return Matrix4<Type>(m);
 	}
 
 	template<class Type>
-	Matrix4<Type&> operator - (const Matrix4<Type>& r1, const Matrix4<Type>& r2)
+	Matrix4<Type> operator - (const Matrix4<Type>& r1, const Matrix4<Type>& r2)
 	{
 		Type m[16];
 		for (int i = 0; i < 16; i++)
 			m[i] = r1.v[i] - r2.v[i];
-		return Matrix4(m);
+		return Matrix4<Type>(m);
 	}
 
 	template<typename Type>
@@ -976,7 +977,7 @@ namespace iv
 		Type m[16];
 		for (int i = 0; i < 16; i++)
 			m[i] = r1.v[i] + r2.v[i];
-		return Matrix4(m);
+		return Matrix4<Type>(m);
 	}
 
 
@@ -1120,10 +1121,10 @@ namespace iv
 		}
 
 
-		template<typename Type> friend Quaternion<Type> operator * (const Quaternion<Type>& r1, const Quaternion<Type>& r2);
-		template<typename Type> friend Quaternion<Type> operator / (const Quaternion<Type>& r1, const Quaternion<Type>& r2);
-		template<typename Type> friend Quaternion<Type> operator / (const Quaternion<Type>& r1, Type val);
-		template<typename Type> friend Vector3<Type> operator * (const Quaternion<Type>& r1, const Vector3<Type>& r2);
+		template<typename U> friend Quaternion<U> operator * (const Quaternion<U>& r1, const Quaternion<U>& r2);
+		template<typename U> friend Quaternion<U> operator / (const Quaternion<U>& r1, const Quaternion<U>& r2);
+		template<typename U> friend Quaternion<U> operator / (const Quaternion<U>& r1, U val);
+		template<typename U> friend Vector3<U> operator * (const Quaternion<U>& r1, const Vector3<U>& r2);
 
 	};
 
@@ -1132,7 +1133,7 @@ namespace iv
 	Quaternion<Type> operator * (const Quaternion<Type>& r1, const Quaternion<Type>& r2)
 	{
 		Vector3<Type> v1(&r1.v[1]), v2(&r2.v[1]);
-		return Quaternion(r1.v[0] * r2.v[0] - dot(v1, v2), r1.v[0] * v2 + r2.v[0] * v1 + cross(v1, v2));
+		return Quaternion<Type>(r1.v[0] * r2.v[0] - dot(v1, v2), r1.v[0] * v2 + r2.v[0] * v1 + cross(v1, v2));
 	}
 
 	template<typename Type>
@@ -1204,7 +1205,7 @@ namespace iv
 	template<class Type>
 	Quaternion<Type> inverse(const Quaternion<Type>& rQuat)
 	{
-		Quaternion conj(rQuat.v[0], -rQuat.v[1], -rQuat.v[2], -rQuat.v[3]);
+		Quaternion<Type> conj(rQuat.v[0], -rQuat.v[1], -rQuat.v[2], -rQuat.v[3]);
 		Type l = rQuat.v[0] * rQuat.v[0] + rQuat.v[1] * rQuat.v[1] + rQuat.v[2] * rQuat.v[2] + rQuat.v[3] * rQuat.v[3];
 		l = sqrt(l);
 		assert(l > Eps || l < -Eps);
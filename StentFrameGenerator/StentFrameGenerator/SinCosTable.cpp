@@ -0,0 +1,48 @@
+#include "SinCosTable.h"
+#include "SharedCache.h"
+#include "SiMath.h"
+
+#include <cmath>
+#include <utility>
+
+namespace
+{
+	typedef SharedCache<std::pair<int, int>, SinCosTable> TableCache;
+}
+
+SinCosTable::SinCosTable(int sampleCnt, int periodCnt)
+{
+	m_Sins.resize(sampleCnt, .0f);
+	m_Coss.resize(sampleCnt, .0f);
+	float drad = iv::ivTWOPI / (double)sampleCnt;
+	for (int i = 0; i < sampleCnt; ++i)
+	{
+		float rad = (float)i * drad;
+		m_Sins[i] = std::sin(rad);
+		m_Coss[i] = std::cos(rad);
+	}
+
+	int total = sampleCnt * periodCnt;
+	m_Sins2.resize(total, .0f);
+	m_Coss2.resize(total, .0f);
+	float drad2 = iv::ivTWOPI / (double)total;
+	for (int i = 0; i < total; ++i)
+	{
+		float rad2 = (float)i * drad2;
+		m_Sins2[i] = std::sin(rad2);
+		m_Coss2[i] = std::cos(rad2);
+	}
+}
+
+std::shared_ptr<const SinCosTable> SinCosTable::Acquire(int sampleCnt, int periodCnt)
+{
+	return TableCache::Get().Acquire(std::make_pair(sampleCnt, periodCnt), [&]
+	{
+		return std::make_shared<const SinCosTable>(sampleCnt, periodCnt);
+	});
+}
+
+void SinCosTable::Purge()
+{
+	TableCache::Get().Purge();
+}
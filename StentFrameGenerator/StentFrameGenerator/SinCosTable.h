@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+/* example */
+/*
+	std::shared_ptr<const SinCosTable> table = SinCosTable::Acquire(32, 12);
+	float s = table->GetSins()[i];
+*/
+
+// sin/cos of one stent design, sampled over one sin period and over the
+// whole ring. Depends on sampleCnt and periodCnt only, so generators of the
+// same design share one immutable table.
+class SinCosTable
+{
+public:
+	// Shared, immutable table of a design. Built on first request and kept
+	// cached after its last generator is gone. Thread-safe.
+	static std::shared_ptr<const SinCosTable> Acquire(int sampleCnt, int periodCnt);
+
+	// Drops the cached tables no generator holds.
+	static void Purge();
+
+	int GetSampleCnt() const { return (int)m_Sins.size(); }
+	int GetTotalCnt() const { return (int)m_Sins2.size(); }
+
+	// sampleCnt entries over 2PI.
+	const float* GetSins() const { return &m_Sins[0]; }
+	const float* GetCoss() const { return &m_Coss[0]; }
+	// sampleCnt * periodCnt entries over 2PI.
+	const float* GetSins2() const { return &m_Sins2[0]; }
+	const float* GetCoss2() const { return &m_Coss2[0]; }
+
+	SinCosTable(int sampleCnt, int periodCnt);
+
+private:
+	std::vector<float> m_Sins;
+	std::vector<float> m_Coss;
+	std::vector<float> m_Sins2;
+	std::vector<float> m_Coss2;
+};
@@ -0,0 +1,60 @@
+#include "StentBatchGenerator.h"
+
+#include <chrono>
+
+StentBatchGenerator::StentBatchGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, bool splineFit, int workerCnt)
+	: m_Generator(sampleCnt, periodCnt, xzScale, yScale, splineFit)
+{
+	// The pool reads 0 workers as one per hardware thread, so a single
+	// thread must not get one.
+	if (workerCnt != 1)
+		m_Pool.reset(new ThreadPool(workerCnt > 1 ? workerCnt - 1 : 0));
+	m_Scratches.resize(m_Pool ? m_Pool->GetSlotCnt() : 1);
+	m_LastStats = Stats();
+}
+
+StentBatchGenerator::~StentBatchGenerator()
+{
+}
+
+void StentBatchGenerator::CreateStentFrames(const std::vector<std::vector<iv::vec3>>& i_lines,
+	std::vector<std::vector<std::vector<iv::vec3>>>& o_frames)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	int lineCnt = (int)i_lines.size();
+	o_frames.resize(lineCnt);
+
+	// Each center-line is one task. The generator is only used through its
+	// const overload, every thread works in its own scratch and every task
+	// writes its own o_frames slot.
+	auto createLines = [&](int begin, int end, int slot)
+	{
+		for (int i = begin; i < end; ++i)
+			m_Generator.CreateStentFrame(i_lines[i], o_frames[i], m_Scratches[slot]);
+	};
+	if (m_Pool)
+		m_Pool->ParallelFor(lineCnt, 1, createLines);
+	else
+		createLines(0, lineCnt, 0);
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	Stats st = Stats();
+	st.CenterlineCnt = lineCnt;
+	st.WorkerCnt = (int)m_Scratches.size();
+	st.Seconds = seconds;
+	for (int i = 0; i < lineCnt; ++i)
+	{
+		st.RingCnt += (int)o_frames[i].size();
+		for (int j = 0; j < o_frames[i].size(); ++j)
+			st.PointCnt += (long long)o_frames[i][j].size();
+	}
+	if (seconds > 0.0)
+	{
+		st.CenterlinesPerSec = lineCnt / seconds;
+		st.PointsPerSec = st.PointCnt / seconds;
+	}
+	m_LastStats = st;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "SiMath.h"
+#include "StentFrameGenerator.h"
+#include "ThreadPool.h"
+
+/* example */
+/*
+	StentBatchGenerator sbg(32, 12, 0.1f, 0.02f, true, 0);
+	vector<vector<vec3>> lines;		// one center-line per candidate stent
+	vector<vector<vector<vec3>>> results;
+	sbg.CreateStentFrames(lines, results);
+	const StentBatchGenerator::Stats& st = sbg.GetLastStats();
+*/
+
+class StentBatchGenerator
+{
+public:
+	// Throughput of the last CreateStentFrames call.
+	struct Stats
+	{
+		int CenterlineCnt;
+		int RingCnt;
+		long long PointCnt;
+		int WorkerCnt;
+		double Seconds;
+		double CenterlinesPerSec;
+		double PointsPerSec;
+	};
+
+	// sampleCnt, periodCnt, xzScale, yScale, splineFit: see StentFrameGenerator.
+	// workerCnt: total threads used for a batch, 1 runs on the calling
+	//            thread only, 0 or less means all hardware threads.
+	StentBatchGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, bool splineFit, int workerCnt);
+
+	~StentBatchGenerator();
+
+	// i_lines: input center-lines.
+	// o_frames: o_frames[i] receives the rings of i_lines[i].
+	void CreateStentFrames(const std::vector<std::vector<iv::vec3>>& i_lines,
+		std::vector<std::vector<std::vector<iv::vec3>>>& o_frames);
+
+	const Stats& GetLastStats() const { return m_LastStats; }
+
+private:
+	StentFrameGenerator m_Generator;
+	// Null when the batch runs on the calling thread only.
+	std::unique_ptr<ThreadPool> m_Pool;
+	std::vector<StentFrameGenerator::Scratch> m_Scratches;
+	Stats m_LastStats;
+};
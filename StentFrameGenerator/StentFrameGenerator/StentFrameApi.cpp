@@ -0,0 +1,154 @@
+#define SFG_BUILDING_API
+#include "StentFrameApi.h"
+#include "StentFrameGenerator.h"
+#include "BeizerSpline.h"
+
+#include <climits>
+#include <mutex>
+
+static_assert(sizeof(iv::vec3) == 3 * sizeof(float), "vec3 must be three packed floats");
+static_assert(SFG_FRAME_ROTATE == StentFrameGenerator::RotateFrame && SFG_FRAME_DOUBLE_REFLECTION == StentFrameGenerator::DoubleReflection
+	&& SFG_FRAME_ROTATE_SCAN == StentFrameGenerator::RotateScan, "frame modes are passed through as is");
+
+struct SfgGenerator
+{
+	SfgGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, bool splineFit)
+		: Generator(sampleCnt, periodCnt, xzScale, yScale, splineFit)
+	{
+	}
+
+	StentFrameGenerator Generator;
+	StentFrameGenerator::Scratch Scratch;
+	std::mutex Mutex;
+};
+
+namespace
+{
+	// Caller points are packed x, y, z floats, read in place as vec3.
+	const iv::vec3* AsPts(const float* pts)
+	{
+		return reinterpret_cast<const iv::vec3*>(pts);
+	}
+
+	// Per-thread spline state for SfgCreateBeizerLine, rebuilt only when the
+	// step changes.
+	struct BeizerLineScratch
+	{
+		BeizerLineScratch() : Step(0.0f), Generator(0.0f)
+		{
+		}
+
+		float Step;
+		BeizerSplineGenerator Generator;
+	};
+
+	// GetSplinePtCnt, or an error if the count doesn't fit an int.
+	int GetBeizerLinePtCnt(const BeizerSplineGenerator& bsg, int ptCnt)
+	{
+		if (ptCnt <= 2)
+			return 0;
+		long long cnt = (long long)(ptCnt - 1) * bsg.GetSegmentSampleCnt() + 1;
+		return cnt > INT_MAX ? SFG_ERROR_INVALID_ARGUMENT : (int)cnt;
+	}
+
+	BeizerSplineGenerator& GetBeizerGenerator(float step)
+	{
+		static thread_local BeizerLineScratch s_Scratch;
+		if (s_Scratch.Step != step)
+		{
+			s_Scratch.Step = step;
+			s_Scratch.Generator = BeizerSplineGenerator(step);
+		}
+		return s_Scratch.Generator;
+	}
+}
+
+SfgGenerator* SfgCreateGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, int splineFit)
+{
+	if (sampleCnt <= 0 || periodCnt <= 0)
+		return 0;
+	return new SfgGenerator(sampleCnt, periodCnt, xzScale, yScale, splineFit != 0);
+}
+
+void SfgDestroyGenerator(SfgGenerator* gen)
+{
+	delete gen;
+}
+
+int SfgSetResampleMode(SfgGenerator* gen, int mode, float spacing)
+{
+	if (gen == 0 || (mode != SFG_RESAMPLE_SAMPLE_GAP && mode != SFG_RESAMPLE_ARC_LENGTH))
+		return SFG_ERROR_INVALID_ARGUMENT;
+
+	std::lock_guard<std::mutex> lock(gen->Mutex);
+	gen->Generator.SetResampleMode(mode == SFG_RESAMPLE_ARC_LENGTH ? StentFrameGenerator::ArcLength : StentFrameGenerator::SampleGap, spacing);
+	return 0;
+}
+
+int SfgSetFrameMode(SfgGenerator* gen, int mode)
+{
+	if (gen == 0 || (mode != SFG_FRAME_ROTATE && mode != SFG_FRAME_DOUBLE_REFLECTION && mode != SFG_FRAME_ROTATE_SCAN))
+		return SFG_ERROR_INVALID_ARGUMENT;
+
+	std::lock_guard<std::mutex> lock(gen->Mutex);
+	gen->Generator.SetFrameMode((StentFrameGenerator::FrameMode)mode);
+	return 0;
+}
+
+int SfgGetRingPointCount(const SfgGenerator* gen)
+{
+	if (gen == 0)
+		return SFG_ERROR_INVALID_ARGUMENT;
+	return gen->Generator.GetRingPtCnt();
+}
+
+int SfgGetFrameCount(SfgGenerator* gen, const float* pts, int ptCnt)
+{
+	if (gen == 0 || ptCnt < 0 || (pts == 0 && ptCnt > 0))
+		return SFG_ERROR_INVALID_ARGUMENT;
+
+	std::lock_guard<std::mutex> lock(gen->Mutex);
+	return gen->Generator.GetFrameCnt(AsPts(pts), ptCnt);
+}
+
+int SfgCreateStentFrame(SfgGenerator* gen, const float* pts, int ptCnt, float* outPts, int outPtCapacity)
+{
+	if (gen == 0 || ptCnt < 0 || (pts == 0 && ptCnt > 0) || (outPts == 0 && outPtCapacity > 0))
+		return SFG_ERROR_INVALID_ARGUMENT;
+
+	std::lock_guard<std::mutex> lock(gen->Mutex);
+
+	// Neither the input nor the rings are copied.
+	int cnt = gen->Generator.CreateStentFrame(AsPts(pts), ptCnt, reinterpret_cast<iv::vec3*>(outPts), outPtCapacity, gen->Scratch);
+	if (cnt >= 0)
+		return cnt;
+	// No buffer holds more than INT_MAX points.
+	long long total = (long long)gen->Scratch.Frames.size() * gen->Generator.GetRingPtCnt();
+	return total > INT_MAX ? SFG_ERROR_INVALID_ARGUMENT : SFG_ERROR_BUFFER_TOO_SMALL;
+}
+
+int SfgGetBeizerLinePointCount(float step, int ptCnt)
+{
+	if (!BeizerSplineGenerator::IsValidStep(step) || ptCnt < 0)
+		return SFG_ERROR_INVALID_ARGUMENT;
+	return GetBeizerLinePtCnt(BeizerSplineGenerator(step), ptCnt);
+}
+
+int SfgCreateBeizerLine(float step, const float* pts, int ptCnt, float* outPts, int outPtCapacity)
+{
+	if (!BeizerSplineGenerator::IsValidStep(step) || ptCnt < 0 || (pts == 0 && ptCnt > 0) || (outPts == 0 && outPtCapacity > 0))
+		return SFG_ERROR_INVALID_ARGUMENT;
+
+	BeizerSplineGenerator& bsg = GetBeizerGenerator(step);
+
+	int cnt = GetBeizerLinePtCnt(bsg, ptCnt);
+	if (cnt < 0)
+		return cnt;
+	if (cnt > outPtCapacity)
+		return SFG_ERROR_BUFFER_TOO_SMALL;
+	if (cnt == 0)
+		return 0;
+
+	bsg.CreateBeizeSpline(AsPts(pts), ptCnt, reinterpret_cast<iv::vec3*>(outPts));
+	return cnt;
+}
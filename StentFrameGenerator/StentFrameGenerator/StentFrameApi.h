@@ -0,0 +1,86 @@
+#ifndef _STENT_FRAME_API_H_
+#define _STENT_FRAME_API_H_
+
+/* C interface of the stent generator for C#, Python and other hosts.
+ *
+ * Points are packed float triplets x, y, z. Results are written straight
+ * into caller-owned buffers, nothing is logged or written to disk.
+ * Different handles can be used from different threads at the same time,
+ * calls on the same handle are serialized.
+ *
+ * example:
+ *
+ *	SfgGenerator* gen = SfgCreateGenerator(32, 12, 0.1f, 0.02f, 1);
+ *	int ringCnt = SfgGetFrameCount(gen, pts, ptCnt);
+ *	float* rings = malloc(ringCnt * SfgGetRingPointCount(gen) * 3 * sizeof(float));
+ *	ringCnt = SfgCreateStentFrame(gen, pts, ptCnt, rings, ringCnt * SfgGetRingPointCount(gen));
+ *	SfgDestroyGenerator(gen);
+ */
+
+#if defined(_WIN32)
+#if defined(SFG_BUILDING_API)
+#define SFG_API __declspec(dllexport)
+#else
+#define SFG_API __declspec(dllimport)
+#endif
+#else
+#define SFG_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Return codes, counts are returned as non-negative values. */
+#define SFG_ERROR_INVALID_ARGUMENT (-1)
+#define SFG_ERROR_BUFFER_TOO_SMALL (-2)
+
+/* Values of SfgSetResampleMode, see StentFrameGenerator::ResampleMode. */
+#define SFG_RESAMPLE_SAMPLE_GAP 0
+#define SFG_RESAMPLE_ARC_LENGTH 1
+
+/* Values of SfgSetFrameMode, see StentFrameGenerator::FrameMode. */
+#define SFG_FRAME_ROTATE 0
+#define SFG_FRAME_DOUBLE_REFLECTION 1
+#define SFG_FRAME_ROTATE_SCAN 2
+
+typedef struct SfgGenerator SfgGenerator;
+
+/* Parameters as in StentFrameGenerator. Returns 0 on invalid arguments. */
+SFG_API SfgGenerator* SfgCreateGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, int splineFit);
+
+SFG_API void SfgDestroyGenerator(SfgGenerator* gen);
+
+SFG_API int SfgSetResampleMode(SfgGenerator* gen, int mode, float spacing);
+
+SFG_API int SfgSetFrameMode(SfgGenerator* gen, int mode);
+
+/* Points per ring, the first point is repeated at the end. */
+SFG_API int SfgGetRingPointCount(const SfgGenerator* gen);
+
+/* Count of rings SfgCreateStentFrame returns for these points. */
+SFG_API int SfgGetFrameCount(SfgGenerator* gen, const float* pts, int ptCnt);
+
+/* pts: ptCnt center-line points.
+ * outPts: receives the rings back to back.
+ * outPtCapacity: capacity of outPts in points, not floats.
+ * return: count of rings written or an SFG_ERROR code,
+ *         SFG_ERROR_INVALID_ARGUMENT if the rings need more than INT_MAX
+ *         points. */
+SFG_API int SfgCreateStentFrame(SfgGenerator* gen, const float* pts, int ptCnt, float* outPts, int outPtCapacity);
+
+/* Count of points SfgCreateBeizerLine returns.
+ * step: t increment inside a segment, at least 1/65536, smaller steps
+ *       are an invalid argument. */
+SFG_API int SfgGetBeizerLinePointCount(float step, int ptCnt);
+
+/* Beizer spline through pts sampled with step, see BeizerSplineGenerator.
+ * return: count of points written or an SFG_ERROR code. */
+SFG_API int SfgCreateBeizerLine(float step, const float* pts, int ptCnt, float* outPts, int outPtCapacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,155 +1,853 @@
 #include "StentFrameGenerator.h"
 #include "BeizerSpline.h"
+#include "RingKernel.h"
+#include "StentProfiler.h"
+#include "ThreadPool.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 
-StentFrameGenerator::StentFrameGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, bool splineFit) : m_SampleCnt(sampleCnt)
+namespace
+{
+	// t step of the fitted Beizer spline.
+	const float s_SplineStep = 0.1f;
+
+	// Rings per ThreadPool chunk, a ring alone is too little work to hand out.
+	const int s_RingGrain = 16;
+
+	iv::vec3 ToFloat(const iv::Vector3<float>& v)
+	{
+		return v;
+	}
+
+	iv::vec3 ToFloat(const iv::Vector3<double>& v)
+	{
+		return iv::vec3((float)v.x, (float)v.y, (float)v.z);
+	}
+
+	// First element for the pointer overloads, 0 if there is none.
+	template<class Point>
+	const Point* GetPts(const std::vector<Point>& pts)
+	{
+		return pts.empty() ? 0 : &pts[0];
+	}
+
+	// Frames per RotateScan chunk. Fixed rather than per thread, so the
+	// rounding and with it the result don't depend on the pool size.
+	const int s_ScanChunk = 4096;
+
+	// Unit quaternion w + (x, y, z). iv::Quaternion doesn't compose or
+	// rotate vectors correctly, so RotateScan carries its own.
+	template<class Type>
+	struct Rotation
+	{
+		Type w, x, y, z;
+
+		static Rotation Identity()
+		{
+			Rotation r = { (Type)1, (Type)0, (Type)0, (Type)0 };
+			return r;
+		}
+
+		// The rotation RotateFrame applies to go from unit tangent t0 to t1,
+		// built from the half-way vector instead of acos and sin/cos: the
+		// quaternion (1 + t0.t1, t0 x t1) normalized.
+		static Rotation Between(const iv::Vector3<Type>& t0, const iv::Vector3<Type>& t1)
+		{
+			iv::Vector3<Type> axis = iv::cross(t0, t1);
+			Type c = iv::dot(t0, t1);
+			Type s = iv::length(axis);
+			// Same cut-off as RotateFrame, about 1e-5 radians.
+			if (c > 0 && s < (Type)0.00001)
+				return Identity();
+			Type w = (Type)1 + c;
+			Type len = std::sqrt(w * w + s * s);
+			Rotation r = { w / len, axis.x / len, axis.y / len, axis.z / len };
+			return r;
+		}
+
+		// this after b, renormalized so long chains don't drift.
+		Rotation operator*(const Rotation& b) const
+		{
+			Rotation r = {
+				w * b.w - x * b.x - y * b.y - z * b.z,
+				w * b.x + x * b.w + y * b.z - z * b.y,
+				w * b.y - x * b.z + y * b.w + z * b.x,
+				w * b.z + x * b.y - y * b.x + z * b.w };
+			Type len = std::sqrt(r.w * r.w + r.x * r.x + r.y * r.y + r.z * r.z);
+			r.w /= len;
+			r.x /= len;
+			r.y /= len;
+			r.z /= len;
+			return r;
+		}
+
+		iv::Vector3<Type> Rotate(const iv::Vector3<Type>& v) const
+		{
+			iv::Vector3<Type> q(x, y, z);
+			iv::Vector3<Type> t = iv::cross(q, v) * (Type)2;
+			return v + t * w + iv::cross(q, t);
+		}
+	};
+
+	// N and B of the first frame, from its tangent alone.
+	template<class Type>
+	void StartFrame(const iv::Vector3<Type>& t, iv::Vector3<Type>& o_n, iv::Vector3<Type>& o_b)
+	{
+		using namespace iv;
+
+		Vector3<Type> tmp = normalize(Vector3<Type>(t.x + (Type)0.5, t.y - (Type)0.5, t.z));
+		o_n = normalize(cross(tmp, t));
+		o_b = normalize(cross(o_n, t));
+	}
+}
+
+template<class Type>
+StentFrameGeneratorT<Type>::Scratch::Scratch() : Bezier(s_SplineStep)
+{
+}
+
+template<class Type>
+StentFrameGeneratorT<Type>::Stream::Stream() : ChunkRingCnt(1)
+	,TotalPtCnt(-1)
+	,PtCnt(0)
+	,Stopped(true)
+	,PtBase(0)
+	,SegCnt(0)
+	,Bezier(s_SplineStep)
+	,Gap(1)
+	,Length(0)
+	,PlacedCnt(0)
+	,EndStart(0)
+	,RingCnt(0)
+{
+}
+
+template<class Type>
+StentFrameGeneratorT<Type>::StentFrameGeneratorT(int sampleCnt, int periodCnt, float xzScale, float yScale, bool splineFit) : m_SampleCnt(sampleCnt)
 	,m_PeriodCnt(periodCnt)
 	,m_PartCnt(10)
+	,m_SplineFit(splineFit)
+	,m_ResampleMode(SampleGap)
+	,m_RingSpacing(0.0f)
+	,m_FrameMode(RotateFrame)
 	,m_xzScale(xzScale)
 	,m_yScale(yScale)
-	,m_SplineFit(splineFit)
+	,m_Pool(0)
 {
 
 	CacheSinsAndCoss();
+	m_RingTemplate = RingTemplate::Acquire(m_SampleCnt, m_PeriodCnt, m_xzScale, m_yScale,
+		m_SinCos->GetSins(), m_SinCos->GetSins2(), m_SinCos->GetCoss2());
 }
 
-StentFrameGenerator::~StentFrameGenerator()
+template<class Type>
+StentFrameGeneratorT<Type>::~StentFrameGeneratorT()
 {
 }
 
-std::vector<iv::vec3> StentFrameGenerator::CreateStentLine(const TNB & tnb, float xzScale, float yScale)
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentLine(const TNB & tnb, iv::vec3* o_pts) const
 {
-	using namespace iv;
-	const vec3& vx = tnb.N;
-	const vec3& vy = tnb.T;
-	const vec3& vz = tnb.B;
+	const RingTemplate& ring = *m_RingTemplate;
+	int total = ring.GetPtCnt();
+	RingKernel::Transform(ring.GetX(), ring.GetY(), ring.GetZ(), total, ToFloat(tnb.O), ToFloat(tnb.N), ToFloat(tnb.T), ToFloat(tnb.B), o_pts);
+	o_pts[total] = o_pts[0];
+}
+
+template<class Type>
+template<class RingPts>
+void StentFrameGeneratorT<Type>::CreateStentLines(const std::vector<TNB>& frames, int first, int last, RingPts ringPts) const
+{
+	STENT_PROFILE_SCOPE(Rings);
+	STENT_PROFILE_COUNT(PointsEmitted, (last - first) * GetRingPtCnt());
+	if (!m_Pool)
+	{
+		for (int i = first; i < last; ++i)
+			CreateStentLine(frames[i], ringPts(i));
+		return;
+	}
+
+	// Every ring depends on its own frame only and owns its output.
+	m_Pool->ParallelFor(last - first, s_RingGrain, [&](int begin, int end, int /*slot*/)
+	{
+		for (int i = first + begin; i < first + end; ++i)
+			CreateStentLine(frames[i], ringPts(i));
+	});
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentLines(const std::vector<TNB>& frames, int first, int last, iv::vec3* o_pts) const
+{
+	int ringPtCnt = GetRingPtCnt();
+	CreateStentLines(frames, first, last, [=](int i) { return o_pts + (i - first) * ringPtCnt; });
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentFrame(const std::vector<Vec3>& i_pts, std::vector<std::vector<iv::vec3>>& o_pts)
+{
+	CreateStentFrame(i_pts, o_pts, m_Scratch);
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentFrame(const std::vector<Vec3>& i_pts, std::vector<std::vector<iv::vec3>>& o_pts, Scratch& scratch) const
+{
+	// o_pts may hold the rings of an earlier call, e.g. in a batch.
+	if (i_pts.empty())
+	{
+		o_pts.clear();
+		return;
+	}
+
+	UpdateFrames(&i_pts[0], i_pts.size(), scratch);
+
+	int ringPtCnt = GetRingPtCnt();
+	int ringCnt = scratch.Frames.size();
+	o_pts.resize(ringCnt);
+	for (int i = 0; i < ringCnt; ++i)
+		o_pts[i].resize(ringPtCnt);
+
+	CreateStentLines(scratch.Frames, 0, ringCnt, [&](int i) { return &o_pts[i][0]; });
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentFrame(const std::vector<Vec3>& i_pts, FrameBuffer& o_buf)
+{
+	CreateStentFrame(i_pts, o_buf, m_Scratch);
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentFrame(const std::vector<Vec3>& i_pts, FrameBuffer& o_buf, Scratch& scratch) const
+{
+	CreateStentFrame(GetPts(i_pts), i_pts.size(), o_buf, scratch);
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentFrame(const Vec3* i_pts, int ptCnt, FrameBuffer& o_buf)
+{
+	CreateStentFrame(i_pts, ptCnt, o_buf, m_Scratch);
+}
 
-	float dx = 4.0f / (float)m_SampleCnt;
+template<class Type>
+void StentFrameGeneratorT<Type>::CreateStentFrame(const Vec3* i_pts, int ptCnt, FrameBuffer& o_buf, Scratch& scratch) const
+{
+	scratch.Frames.clear();
+	if (ptCnt > 0)
+		UpdateFrames(i_pts, ptCnt, scratch);
+
+	int ringCnt = scratch.Frames.size();
+	int ringPtCnt = GetRingPtCnt();
+
+	o_buf.RingCnt = ringCnt;
+	o_buf.RingPtCnt = ringPtCnt;
+	STENT_PROFILE_WATCH(o_buf.Pts);
+	STENT_PROFILE_WATCH(o_buf.RingOffsets);
+	o_buf.Pts.resize(ringCnt * ringPtCnt);
+	o_buf.RingOffsets.resize(ringCnt);
+	for (int i = 0; i < ringCnt; ++i)
+		o_buf.RingOffsets[i] = i * ringPtCnt;
+	if (ringCnt > 0)
+		CreateStentLines(scratch.Frames, 0, ringCnt, &o_buf.Pts[0]);
+}
 
-	std::vector<vec3> pts;
+template<class Type>
+int StentFrameGeneratorT<Type>::CreateStentFrame(const std::vector<Vec3>& i_pts, iv::vec3* o_pts, int maxPtCnt, Scratch& scratch) const
+{
+	return CreateStentFrame(GetPts(i_pts), i_pts.size(), o_pts, maxPtCnt, scratch);
+}
+
+template<class Type>
+int StentFrameGeneratorT<Type>::CreateStentFrame(const Vec3* i_pts, int ptCnt, iv::vec3* o_pts, int maxPtCnt, Scratch& scratch) const
+{
+	if (ptCnt <= 0)
+		return 0;
 
-	for (int j = 0; j < m_PeriodCnt; ++j)
+	UpdateFrames(i_pts, ptCnt, scratch);
+
+	const std::vector<TNB>& frames = scratch.Frames;
+	// In long long, a long center line with a large design overflows int.
+	if ((long long)frames.size() * GetRingPtCnt() > maxPtCnt)
+		return -1;
+
+	CreateStentLines(frames, 0, frames.size(), o_pts);
+	return (int)frames.size();
+}
+
+template<class Type>
+bool StentFrameGeneratorT<Type>::BeginStream(Stream& stream, long long ptCnt, int chunkRingCnt, const RingSink& sink) const
+{
+	// Reset field by field, the buffers keep their capacity.
+	stream.Sink = sink;
+	stream.ChunkRingCnt = std::max(1, chunkRingCnt);
+	stream.TotalPtCnt = ptCnt;
+	stream.PtCnt = 0;
+	stream.Stopped = !sink;
+	stream.Pts.clear();
+	stream.PtBase = 0;
+	stream.SegCnt = 0;
+	stream.Gap = 1;
+	stream.Length = 0;
+	stream.PlacedCnt = 0;
+	stream.HeldPts.clear();
+	stream.EndStart = 0;
+	stream.SamplePts.clear();
+	stream.Frames.clear();
+	stream.RingCnt = 0;
+	stream.Rings.resize(stream.ChunkRingCnt * GetRingPtCnt());
+
+	if (m_SplineFit && m_ResampleMode == ArcLength && m_RingSpacing <= 0.0f)
+		stream.Stopped = true;
+	if (m_SplineFit && m_ResampleMode == SampleGap)
 	{
-		float xBase = (float)j * 4.0f;
-		for (int i = 0; i < m_SampleCnt; ++i)
+		if (ptCnt < 0)
+			stream.Stopped = true;
+		else
 		{
-			vec3 p;
-			p.x = dx * (float)i + xBase;
-			p.y = yScale * m_CachedSins[i];
-			pts.push_back(p);
+			// Same gap as SampleSpline picks for the whole spline.
+			long long bzcnt = ptCnt > 2 ? (ptCnt - 1) * stream.Bezier.GetSegmentSampleCnt() + 1 : 0;
+			stream.Gap = std::max(1LL, bzcnt / m_PartCnt);
 		}
 	}
+	return !stream.Stopped;
+}
+
+template<class Type>
+bool StentFrameGeneratorT<Type>::PushStream(Stream& stream, const Vec3* i_pts, int ptCnt) const
+{
+	if (stream.Stopped || ptCnt <= 0)
+		return !stream.Stopped;
 
-	for (int i = 0; i < pts.size(); ++i)
+	stream.PtCnt += ptCnt;
+	if (!m_SplineFit)
+		stream.SamplePts.insert(stream.SamplePts.end(), i_pts, i_pts + ptCnt);
+	else
 	{
-		pts[i].x = xzScale * m_CachedSins2[i];
-		pts[i].z = xzScale * m_CachedCoss2[i];
+		// Segment i needs points i - 1 .. i + 2.
+		stream.Pts.insert(stream.Pts.end(), i_pts, i_pts + ptCnt);
+		StreamSpline(stream, stream.PtCnt - 2);
 	}
+	StreamFrames(stream);
+	return !stream.Stopped;
+}
+
+template<class Type>
+bool StentFrameGeneratorT<Type>::EndStream(Stream& stream) const
+{
+	if (stream.Stopped)
+		return false;
 
-	for (int i = 0; i < pts.size(); ++i)
+	if (m_SplineFit && m_ResampleMode == SampleGap && stream.PtCnt != stream.TotalPtCnt)
 	{
-		const vec3& p = pts[i];
-		pts[i] = tnb.O + vx * p.x + vy * p.y + vz * p.z;
+		stream.Stopped = true;
+		return false;
+	}
+
+	if (m_SplineFit && stream.PtCnt > 2)
+	{
+		// The last segment ends on the last point, nothing follows it.
+		StreamSpline(stream, stream.PtCnt - 1);
+		if (m_ResampleMode == SampleGap)
+		{
+			// The spline's last sample is the last point itself.
+			long long last = (stream.PtCnt - 1) * stream.Bezier.GetSegmentSampleCnt();
+			if (last % stream.Gap == 0)
+				stream.SamplePts.push_back(stream.Pts.back());
+		}
+		else
+		{
+			// Now the length is final: keep the held origins SampleSpacing
+			// places, the rest of its points lie past the end, which
+			// Evaluate clamps to the end.
+			Type spacing = (Type)m_RingSpacing;
+			long long cnt = (long long)(stream.Length / spacing) + 1;
+			long long heldFirst = stream.PlacedCnt - (long long)stream.HeldPts.size();
+			long long keep = std::max(0LL, std::min((long long)stream.HeldPts.size(), cnt - heldFirst));
+			stream.SamplePts.insert(stream.SamplePts.end(), stream.HeldPts.begin(), stream.HeldPts.begin() + keep);
+			stream.HeldPts.clear();
+			for (long long i = stream.PlacedCnt; i < cnt; ++i)
+				stream.SamplePts.push_back(ArcLengthSplineT<Type>::EvaluateSegment(stream.EndCtrl, stream.EndStart, stream.Length, stream.Length));
+		}
 	}
 
-	pts.push_back(pts[0]);
-	return pts;
+	StreamFrames(stream);
+	bool ok = !stream.Stopped;
+	stream.Stopped = true;
+	return ok;
 }
 
-void StentFrameGenerator::CreateStentFrame(const std::vector<iv::vec3>& i_pts, std::vector<std::vector<iv::vec3>>& o_pts)
+template<class Type>
+void StentFrameGeneratorT<Type>::StreamSpline(Stream& stream, long long segEnd) const
 {
-	using namespace std;
-	using namespace iv;
-	if (i_pts.empty())
+	if (segEnd <= stream.SegCnt)
 		return;
 
+	// The segments are those of the whole spline: the points around them
+	// are all in the window, the window's own ends only clamp the inner
+	// control points of segments outside first .. last - 1.
+	const Vec3* pts = &stream.Pts[0];
+	int ptCnt = stream.Pts.size();
+	int first = (int)(stream.SegCnt - stream.PtBase);
+	int last = (int)(segEnd - stream.PtBase);
+	if (m_ResampleMode == ArcLength)
+	{
+		{
+			STENT_PROFILE_SCOPE(Spline);
+			stream.Bezier.CreateSegments(pts, ptCnt, stream.Ctrl);
+		}
+		STENT_PROFILE_SCOPE(Resample);
+		for (int i = first; i < last; ++i)
+			StreamArcSegment(stream, &stream.Ctrl[4 * i]);
 
-	if (m_SplineFit)
+		// Held origins SampleSpacing places even for the current length,
+		// a longer spline only places more.
+		Type spacing = (Type)m_RingSpacing;
+		long long cnt = (long long)(stream.Length / spacing) + 1;
+		long long heldFirst = stream.PlacedCnt - (long long)stream.HeldPts.size();
+		long long pass = std::max(0LL, std::min((long long)stream.HeldPts.size(), cnt - heldFirst));
+		stream.SamplePts.insert(stream.SamplePts.end(), stream.HeldPts.begin(), stream.HeldPts.begin() + pass);
+		stream.HeldPts.erase(stream.HeldPts.begin(), stream.HeldPts.begin() + pass);
+	}
+	else
+	{
+		{
+			STENT_PROFILE_SCOPE(Spline);
+			stream.Bezier.CreateBeizeSpline(pts, ptCnt, stream.BezierPts);
+		}
+		STENT_PROFILE_SCOPE(Resample);
+		long long segSampleCnt = stream.Bezier.GetSegmentSampleCnt();
+		long long base = stream.PtBase * segSampleCnt;
+		long long end = segEnd * segSampleCnt;
+		long long gap = stream.Gap;
+		for (long long j = (stream.SegCnt * segSampleCnt + gap - 1) / gap * gap; j < end; j += gap)
+			stream.SamplePts.push_back(stream.BezierPts[j - base]);
+	}
+
+	stream.SegCnt = segEnd;
+	long long keep = std::max(0LL, segEnd - 1);
+	stream.Pts.erase(stream.Pts.begin(), stream.Pts.begin() + (keep - stream.PtBase));
+	stream.PtBase = keep;
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::StreamArcSegment(Stream& stream, const Vec3* ctrl) const
+{
+	typedef ArcLengthSplineT<Type> Spline;
+
+	// Same running sum as ArcLengthSpline::Build.
+	Type start = stream.Length;
+	Type end = start + Spline::GetSegmentLength(ctrl);
+	stream.Length = end;
+
+	// Evaluate's lower_bound picks the first segment reaching a length, so
+	// segments that add nothing don't take over the end. The first segment
+	// always places the ring at 0, nothing is placed before it.
+	if (stream.PlacedCnt == 0 || end > start)
+	{
+		std::copy(ctrl, ctrl + 4, stream.EndCtrl);
+		stream.EndStart = start;
+	}
+
+	Type spacing = (Type)m_RingSpacing;
+	for (;;)
+	{
+		Type s = spacing * (Type)stream.PlacedCnt;
+		if (s > end)
+			break;
+		stream.HeldPts.push_back(Spline::EvaluateSegment(ctrl, start, end, s));
+		++stream.PlacedCnt;
+	}
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::StreamFrames(Stream& stream) const
+{
+	int cnt = stream.SamplePts.size();
+	if (cnt < 2)
+		return;
+
+	int first = stream.Frames.empty() ? 0 : 1;
+	UpdateTNBFrames(&stream.SamplePts[0], cnt, stream.Frames, first);
+
+	int frameCnt = stream.Frames.size();
+	for (int i = first; i < frameCnt && !stream.Stopped; i += stream.ChunkRingCnt)
 	{
-		BeizerSplineGenerator bsg(0.1f);
-		vector<vec3> bzpts,realipts;
-		bsg.CreateBeizeSpline(i_pts, bzpts);
-		int bzcnt = bzpts.size();
-		cout << "bzcnt:" << bzcnt << endl;
-		int gap = bzcnt / m_PartCnt;
-		cout << "gap:" << gap << endl;
-		for (int i = 0; i < bzcnt; i += gap)
+		int last = std::min(frameCnt, i + stream.ChunkRingCnt);
+		CreateStentLines(stream.Frames, i, last, &stream.Rings[0]);
+		if (!stream.Sink(&stream.Rings[0], stream.RingCnt, last - i))
+			stream.Stopped = true;
+		stream.RingCnt += last - i;
+	}
+
+	// The next frame only needs the last one, its origin and the origin
+	// still waiting for a successor.
+	stream.Frames.erase(stream.Frames.begin(), stream.Frames.end() - 1);
+	stream.SamplePts.erase(stream.SamplePts.begin(), stream.SamplePts.end() - 2);
+}
+
+template<class Type>
+int StentFrameGeneratorT<Type>::UpdateControlPoint(std::vector<Vec3>& io_pts, int k, const Vec3& pos, FrameBuffer& io_buf)
+{
+	return UpdateControlPoint(io_pts, k, pos, io_buf, m_Scratch);
+}
+
+template<class Type>
+int StentFrameGeneratorT<Type>::UpdateControlPoint(std::vector<Vec3>& io_pts, int k, const Vec3& pos, FrameBuffer& io_buf, Scratch& scratch) const
+{
+	int ptCnt = io_pts.size();
+	if (k < 0 || k >= ptCnt)
+		return io_buf.RingCnt;
+
+	io_pts[k] = pos;
+
+	int ringPtCnt = GetRingPtCnt();
+	bool valid = io_buf.RingCnt == (int)scratch.Frames.size()
+		&& io_buf.RingPtCnt == ringPtCnt
+		&& (int)io_buf.Pts.size() == io_buf.RingCnt * ringPtCnt;
+
+	// First frame whose T or O moved, the ones after it follow.
+	int first = 0;
+	if (!m_SplineFit)
+	{
+		valid = valid && io_buf.RingCnt == GetFrameCnt(ptCnt);
+		first = std::max(0, k - 1);
+	}
+	else if (m_ResampleMode == SampleGap && ptCnt > 2)
+	{
+		int bzcnt = scratch.Bezier.GetSplinePtCnt(ptCnt);
+		int gap = std::max(1, bzcnt / m_PartCnt);
+		valid = valid && (int)scratch.BezierPts.size() == bzcnt
+			&& (int)scratch.SamplePts.size() == (bzcnt + gap - 1) / gap;
+		if (valid)
 		{
-			cout << "--:" << i << endl;
-			realipts.push_back(bzpts[i]);
+			int bzFirst, bzLast;
+			{
+				STENT_PROFILE_SCOPE(Spline);
+				scratch.Bezier.UpdateBeizeSpline(io_pts, k, &scratch.BezierPts[0], bzFirst, bzLast);
+			}
+
+			// Only every gap-th spline sample becomes a ring origin.
+			int sampleFirst = (bzFirst + gap - 1) / gap;
+			int sampleLast = bzLast / gap;
+			if (sampleFirst > sampleLast)
+				return io_buf.RingCnt;
+			for (int i = sampleFirst; i <= sampleLast; ++i)
+				scratch.SamplePts[i] = scratch.BezierPts[i * gap];
+			first = std::max(0, sampleFirst - 1);
 		}
-		UpdateTNBFrames(realipts);
 	}
 	else
-		UpdateTNBFrames(i_pts);
-	o_pts.clear();
-	for (int i = 0; i < m_Frames.size(); ++i)
+		valid = false;
+
+	if (!valid)
+	{
+		CreateStentFrame(io_pts, io_buf, scratch);
+		return 0;
+	}
+
+	if (first >= io_buf.RingCnt)
+		return io_buf.RingCnt;
+
+	const std::vector<Vec3>& framePts = m_SplineFit ? scratch.SamplePts : io_pts;
+	UpdateTNBFrames(GetPts(framePts), framePts.size(), scratch.Frames, first);
+	CreateStentLines(scratch.Frames, first, io_buf.RingCnt, &io_buf.Pts[first * ringPtCnt]);
+	return first;
+}
+
+template<class Type>
+int StentFrameGeneratorT<Type>::GetFrameCnt(int ptCnt) const
+{
+	if (!m_SplineFit)
+		return ptCnt > 1 ? ptCnt - 1 : 0;
+
+	if (ptCnt <= 2)
+		return 0;
+
+	if (m_ResampleMode == ArcLength)
+		return m_RingSpacing > 0.0f ? -1 : m_PartCnt;
+
+	int bzcnt = BeizerSplineGeneratorT<Type>(s_SplineStep).GetSplinePtCnt(ptCnt);
+	int gap = std::max(1, bzcnt / m_PartCnt);
+	int sampleCnt = (bzcnt + gap - 1) / gap;
+	return sampleCnt > 1 ? sampleCnt - 1 : 0;
+}
+
+template<class Type>
+int StentFrameGeneratorT<Type>::GetFrameCnt(const std::vector<Vec3>& i_pts) const
+{
+	return GetFrameCnt(GetPts(i_pts), i_pts.size());
+}
+
+template<class Type>
+int StentFrameGeneratorT<Type>::GetFrameCnt(const Vec3* i_pts, int ptCnt) const
+{
+	int cnt = GetFrameCnt(ptCnt);
+	if (cnt >= 0)
+		return cnt;
+
+	ArcLengthSplineT<Type> spline;
+	spline.Build(i_pts, ptCnt);
+	return (int)(spline.GetLength() / m_RingSpacing);
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::Reserve(int ptCnt, Scratch& scratch, FrameBuffer& o_buf) const
+{
+	if (ptCnt <= 0)
+		return;
+
+	int sampleCnt = ptCnt;
+	if (m_SplineFit)
+	{
+		int bzcnt = scratch.Bezier.GetSplinePtCnt(ptCnt);
+		sampleCnt = std::max(bzcnt, m_PartCnt + 1);
+		scratch.Bezier.Reserve(ptCnt);
+		scratch.BezierPts.reserve(bzcnt);
+		scratch.SamplePts.reserve(sampleCnt);
+		scratch.Spline.Reserve(ptCnt);
+	}
+	scratch.Frames.reserve(sampleCnt);
+
+	int ringCnt = GetFrameCnt(ptCnt);
+	if (ringCnt > 0)
+	{
+		o_buf.Pts.reserve(ringCnt * GetRingPtCnt());
+		o_buf.RingOffsets.reserve(ringCnt);
+	}
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::SetResampleMode(ResampleMode mode, float spacing)
+{
+	m_ResampleMode = mode;
+	m_RingSpacing = spacing;
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::SetFrameMode(FrameMode mode)
+{
+	m_FrameMode = mode;
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::UpdateFrames(const Vec3* i_pts, int ptCnt, Scratch& scratch) const
+{
+	if (m_SplineFit)
+	{
+		SampleSpline(i_pts, ptCnt, scratch);
+		UpdateTNBFrames(GetPts(scratch.SamplePts), scratch.SamplePts.size(), scratch.Frames);
+	}
+	else
+		UpdateTNBFrames(i_pts, ptCnt, scratch.Frames);
+}
+
+template<class Type>
+void StentFrameGeneratorT<Type>::SampleSpline(const Vec3* i_pts, int ptCnt, Scratch& scratch) const
+{
+	using namespace std;
+	using namespace iv;
+
+	vector<Vec3>& realipts = scratch.SamplePts;
+	realipts.clear();
+	STENT_PROFILE_WATCH(realipts);
+
+	if (m_ResampleMode == ArcLength)
 	{
-		o_pts.push_back(CreateStentLine(m_Frames[i], m_xzScale, m_yScale));
+		// Only the per-segment length table is built, the spline is never
+		// sampled densely.
+		{
+			STENT_PROFILE_SCOPE(Spline);
+			scratch.Spline.Build(i_pts, ptCnt);
+		}
+		STENT_PROFILE_SCOPE(Resample);
+		if (m_RingSpacing > 0.0f)
+			scratch.Spline.SampleSpacing(m_RingSpacing, realipts);
+		else
+			scratch.Spline.SampleUniform(m_PartCnt, realipts);
+		return;
 	}
+
+	vector<Vec3>& bzpts = scratch.BezierPts;
+	bzpts.clear();
+	{
+		STENT_PROFILE_SCOPE(Spline);
+		STENT_PROFILE_WATCH(bzpts);
+		scratch.Bezier.CreateBeizeSpline(i_pts, ptCnt, bzpts);
+	}
+	STENT_PROFILE_SCOPE(Resample);
+	int bzcnt = bzpts.size();
+	// Short splines have fewer samples than parts, take all of them.
+	int gap = max(1, bzcnt / m_PartCnt);
+	for (int i = 0; i < bzcnt; i += gap)
+		realipts.push_back(bzpts[i]);
 }
 
-void StentFrameGenerator::UpdateTNBFrames(const std::vector<iv::vec3>& pts)
+template<class Type>
+void StentFrameGeneratorT<Type>::UpdateTNBFrames(const Vec3* pts, int ptCnt, std::vector<TNB>& o_frames, int first) const
 {
 	using namespace iv;
 
-	m_Frames.clear();
+	STENT_PROFILE_SCOPE(Frames);
+	STENT_PROFILE_COUNT(FramesBuilt, std::max(0, ptCnt - 1 - std::max(0, first)));
+	STENT_PROFILE_WATCH(o_frames);
+	if (m_FrameMode == RotateScan)
+	{
+		ScanTNBFrames(pts, ptCnt, o_frames, first);
+		return;
+	}
+
+	if (first > 0)
+		o_frames.resize(first);
+	else
+	{
+		first = 0;
+		o_frames.clear();
+	}
 
-	int ptCnt = pts.size();
-	for (int i = 0; i < ptCnt - 1; ++i)
+	if (ptCnt > 1)
+		o_frames.reserve(ptCnt - 1);
+	for (int i = first; i < ptCnt - 1; ++i)
 	{
 		TNB tnb;
-		const vec3& p0 = pts[i];
-		const vec3& p1 = pts[i + 1];
+		const Vec3& p0 = pts[i];
+		const Vec3& p1 = pts[i + 1];
 		tnb.T = normalize(p1 - p0);
 		if (i == 0)
 		{
-			vec3 tmp = normalize(vec3(tnb.T.x + 0.5f, tnb.T.y - 0.5f, tnb.T.z));
-			tnb.N = normalize(cross(tmp, tnb.T));
-			tnb.B = normalize(cross(tnb.N, tnb.T));
+			StartFrame(tnb.T, tnb.N, tnb.B);
+		}
+		else if (m_FrameMode == DoubleReflection)
+		{
+			// Wang et al. 2008: reflect the previous frame across the plane
+			// bisecting the two origins, then across the plane that takes
+			// the reflected tangent onto the new one.
+			const TNB& prev = o_frames[i - 1];
+			Vec3 v1 = p0 - prev.O;
+			Type c1 = dot(v1, v1);
+			Vec3 rL = prev.N;
+			Vec3 tL = prev.T;
+			if (c1 > (Type)1e-20f)
+			{
+				rL = prev.N - v1 * ((Type)2 / c1 * dot(v1, prev.N));
+				tL = prev.T - v1 * ((Type)2 / c1 * dot(v1, prev.T));
+			}
+			Vec3 v2 = tnb.T - tL;
+			Type c2 = dot(v2, v2);
+			tnb.N = (c2 > (Type)1e-20f) ? rL - v2 * ((Type)2 / c2 * dot(v2, rL)) : rL;
+			tnb.B = cross(tnb.N, tnb.T);
 		}
 		else
 		{
-			float rad = iv::GetRadianBetween(m_Frames[i - 1].T, tnb.T);
+			const TNB& prev = o_frames[i - 1];
+			Type rad = (Type)iv::GetRadianBetween(prev.T, tnb.T);
 			if (rad < 0.00001)
 			{
-				tnb.N = m_Frames[i - 1].N;
-				tnb.B = m_Frames[i - 1].B;
+				tnb.N = prev.N;
+				tnb.B = prev.B;
 			}
 			else
 			{
-				vec3 axis = normalize(cross(m_Frames[i - 1].T, tnb.T));
-				mat4 rotMat = rotate(rad, axis);
-				tnb.N = (rotMat * vec4(m_Frames[i - 1].N, .0f)).xyz();
-				tnb.B = (rotMat * vec4(m_Frames[i - 1].B, .0f)).xyz();
+				Vec3 axis = normalize(cross(prev.T, tnb.T));
+				Matrix4<Type> rotMat = rotate(rad, axis);
+				tnb.N = (rotMat * Vector4<Type>(prev.N, (Type)0)).xyz();
+				tnb.B = (rotMat * Vector4<Type>(prev.B, (Type)0)).xyz();
 			}
 		}
 		tnb.O = p0;
-		m_Frames.push_back(tnb);
+		o_frames.push_back(tnb);
 	}
 }
 
-void StentFrameGenerator::CacheSinsAndCoss()
+template<class Type>
+void StentFrameGeneratorT<Type>::ScanTNBFrames(const Vec3* pts, int ptCnt, std::vector<TNB>& o_frames, int first) const
 {
-	m_CachedSins.resize(m_SampleCnt, .0f);
-	m_CachedCoss.resize(m_SampleCnt, .0f);
-	float drad = iv::ivTWOPI / (double)m_SampleCnt;
-	for (int i = 0; i < m_SampleCnt; ++i)
+	typedef Rotation<Type> Rot;
+
+	int frameCnt = std::max(0, ptCnt - 1);
+	first = std::max(0, std::min(first, std::min((int)o_frames.size(), frameCnt)));
+	o_frames.resize(frameCnt);
+	if (first == frameCnt)
+		return;
+
+	if (first == 0)
 	{
-		float rad = (float)i * drad;
-		m_CachedSins[i] = std::sinf(rad);
-		m_CachedCoss[i] = std::cosf(rad);
+		TNB& tnb = o_frames[0];
+		tnb.T = normalize(pts[1] - pts[0]);
+		StartFrame(tnb.T, tnb.N, tnb.B);
+		tnb.O = pts[0];
+		first = 1;
 	}
 
-	int total = m_SampleCnt * m_PeriodCnt;
-	m_CachedSins2.resize(total, .0f);
-	m_CachedCoss2.resize(total, .0f);
-	float drad2 = iv::ivTWOPI / (double)total;
-	for (int i = 0; i < total; ++i)
+	// Frame i is frame first - 1 turned by R(i) * .. * R(first), R(i) taking
+	// T(i - 1) onto T(i). Each chunk forms its own product, a short serial
+	// pass turns those into the rotation every chunk starts from, then the
+	// chunks apply their running products. Rotations are recomputed in the
+	// second pass instead of being stored.
+	const TNB base = o_frames[first - 1];
+	int cnt = frameCnt - first;
+	int chunkCnt = (cnt + s_ScanChunk - 1) / s_ScanChunk;
+	std::vector<Rot> carries(chunkCnt);
+
+	auto forChunks = [&](const std::function<void(int)>& fn)
+	{
+		if (!m_Pool)
+		{
+			for (int c = 0; c < chunkCnt; ++c)
+				fn(c);
+			return;
+		}
+		m_Pool->ParallelFor(chunkCnt, 1, [&](int begin, int end, int /*slot*/)
+		{
+			for (int c = begin; c < end; ++c)
+				fn(c);
+		});
+	};
+
+	forChunks([&](int c)
+	{
+		int begin = first + c * s_ScanChunk;
+		int end = std::min(frameCnt, begin + s_ScanChunk);
+		Vec3 prevT = (c == 0) ? base.T : normalize(pts[begin] - pts[begin - 1]);
+		Rot q = Rot::Identity();
+		for (int i = begin; i < end; ++i)
+		{
+			TNB& tnb = o_frames[i];
+			tnb.T = normalize(pts[i + 1] - pts[i]);
+			tnb.O = pts[i];
+			q = Rot::Between(prevT, tnb.T) * q;
+			prevT = tnb.T;
+		}
+		carries[c] = q;
+	});
+
+	Rot carry = Rot::Identity();
+	for (int c = 0; c < chunkCnt; ++c)
 	{
-		float rad2 = (float)i * drad2;
-		m_CachedSins2[i] = std::sinf(rad2);
-		m_CachedCoss2[i] = std::cosf(rad2);
+		Rot total = carries[c];
+		carries[c] = carry;
+		carry = total * carry;
 	}
+
+	forChunks([&](int c)
+	{
+		int begin = first + c * s_ScanChunk;
+		int end = std::min(frameCnt, begin + s_ScanChunk);
+		Rot q = carries[c];
+		for (int i = begin; i < end; ++i)
+		{
+			TNB& tnb = o_frames[i];
+			q = Rot::Between(o_frames[i - 1].T, tnb.T) * q;
+			tnb.N = q.Rotate(base.N);
+			tnb.B = q.Rotate(base.B);
+		}
+	});
 }
+
+template<class Type>
+void StentFrameGeneratorT<Type>::CacheSinsAndCoss()
+{
+	m_SinCos = SinCosTable::Acquire(m_SampleCnt, m_PeriodCnt);
+}
+
+template class StentFrameGeneratorT<float>;
+template class StentFrameGeneratorT<double>;
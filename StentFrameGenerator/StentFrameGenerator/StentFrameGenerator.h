@@ -1,7 +1,15 @@
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <vector>
 #include "SiMath.h"
+#include "ArcLengthSpline.h"
+#include "BeizerSpline.h"
+#include "RingTemplate.h"
+#include "SinCosTable.h"
+
+class ThreadPool;
 
 /* example */
 /*
@@ -15,48 +23,292 @@
 	sfg.CreateStentFrame(pts, result);
 */
 
-class StentFrameGenerator
+/* example */
+/*
+	// A center line too long to hold, rings written as they are made.
+	StentFrameGenerator::Stream stream;
+	sfg.BeginStream(stream, reader.GetPtCnt(), 256, [&](const vec3* rings, int firstRing, int ringCnt)
+	{
+		return writer.WriteRings(rings, ringCnt);
+	});
+	const vec3* pts;
+	int cnt;
+	while ((cnt = reader.ReadChunk(1 << 20, 0, pts)) > 0)
+		sfg.PushStream(stream, pts, cnt);
+	sfg.EndStream(stream);
+*/
+
+// Type: scalar of the center line, the fitted spline and the frames carried
+// along it, float or double. Rings are always emitted as float, so double
+// only buys frame accuracy on long center lines.
+template<class Type>
+class StentFrameGeneratorT
 {
-private:
+public:
+	typedef iv::Vector3<Type> Vec3;
+
 	struct TNB
 	{
-		iv::vec3 T;
-		iv::vec3 N;
-		iv::vec3 B;
-		iv::vec3 O;
+		Vec3 T;
+		Vec3 N;
+		Vec3 B;
+		Vec3 O;
 	};
-public:
+
+	// How ring positions are picked on the fitted spline.
+	enum ResampleMode
+	{
+		// Every (spline sample count / part count)-th spline sample.
+		SampleGap,
+		// Equal arc length steps, see SetResampleMode.
+		ArcLength
+	};
+
+	// How N/B are carried from one frame to the next.
+	enum FrameMode
+	{
+		// Rotate by the angle between tangents, acos and a mat4 per frame.
+		RotateFrame,
+		// Double reflection rotation minimizing frames, dot products only.
+		DoubleReflection,
+		// RotateFrame's rotations as quaternions, chained by a prefix
+		// product over fixed chunks of frames that run on the thread pool.
+		// Same frames as RotateFrame up to rounding, with or without a pool.
+		// Meant for center lines of 10^5+ points.
+		RotateScan
+	};
+
+	// Intermediate buffers of one CreateStentFrame call. Give every thread
+	// its own Scratch to run the const overload concurrently. Buffers keep
+	// their capacity, so once a Scratch has seen an input of some size,
+	// further calls with that size and the same output object allocate
+	// nothing.
+	struct Scratch
+	{
+		Scratch();
+
+		BeizerSplineGeneratorT<Type> Bezier;
+		std::vector<Vec3> BezierPts;
+		std::vector<Vec3> SamplePts;
+		std::vector<TNB> Frames;
+		ArcLengthSplineT<Type> Spline;
+	};
+
+	// All rings of one stent in one contiguous array: ring i is
+	// Pts[RingOffsets[i]] .. Pts[RingOffsets[i] + RingPtCnt - 1].
+	struct FrameBuffer
+	{
+		std::vector<iv::vec3> Pts;
+		std::vector<int> RingOffsets;
+		int RingCnt;
+		int RingPtCnt;
+	};
+
+	// Receives the rings of a stream as they are made.
+	// pts: ringCnt rings back to back, only valid during the call.
+	// firstRing: index of the first of them in the whole stent.
+	// return: false stops the stream.
+	typedef std::function<bool(const iv::vec3* pts, int firstRing, int ringCnt)> RingSink;
+
+	// State of one streamed stent, see BeginStream. Between pushes it holds
+	// three center-line points, two ring origins and one frame, during a
+	// push buffers for that push and one chunk of rings. Its size never
+	// depends on the length of the center line.
+	struct Stream
+	{
+		Stream();
+
+		RingSink Sink;
+		int ChunkRingCnt;
+		// Points announced by BeginStream and pushed so far.
+		long long TotalPtCnt;
+		long long PtCnt;
+		bool Stopped;
+
+		// Center-line points from PtBase on, the spline segments before
+		// SegCnt are done.
+		std::vector<Vec3> Pts;
+		long long PtBase;
+		long long SegCnt;
+		BeizerSplineGeneratorT<Type> Bezier;
+		std::vector<Vec3> BezierPts;
+		std::vector<Vec3> Ctrl;
+
+		// SampleGap: every Gap-th spline sample is a ring origin.
+		long long Gap;
+
+		// ArcLength: spline length so far and ring origins placed on it.
+		// The last HeldPts of them aren't passed on until the length shows
+		// SampleSpacing would place them too.
+		Type Length;
+		long long PlacedCnt;
+		std::vector<Vec3> HeldPts;
+		// The segment Evaluate finds for the end of the spline so far.
+		Vec3 EndCtrl[4];
+		Type EndStart;
+
+		// Ring origins without a frame yet. Once there are frames, Frames[0]
+		// is the last one made and SamplePts[0] its origin.
+		std::vector<Vec3> SamplePts;
+		std::vector<TNB> Frames;
+		int RingCnt;
+		std::vector<iv::vec3> Rings;
+	};
+
 	// sampleCnt: sample count of 2PI.
 	// periodCnt: count of sin periond repeated in a layer.
 	// xzScale: scale factor of xz plane.
 	// yScale: scale factor of y direction.
 	// splineFit: whether use beizer spline to fit the center-line.
-	StentFrameGenerator(int sampleCnt, int periodCnt,float xzScale,float yScale, bool splineFit);
+	StentFrameGeneratorT(int sampleCnt, int periodCnt,float xzScale,float yScale, bool splineFit);
 
-	~StentFrameGenerator();
+	~StentFrameGeneratorT();
 
 	// i_pts: input points.
 	// o_pts: output points.
-	void CreateStentFrame(const std::vector<iv::vec3>& i_pts, std::vector<std::vector<iv::vec3>>& o_pts);
+	void CreateStentFrame(const std::vector<Vec3>& i_pts, std::vector<std::vector<iv::vec3>>& o_pts);
+
+	// Same as above but keeps all intermediate state in scratch, so one
+	// generator can be shared by many threads.
+	void CreateStentFrame(const std::vector<Vec3>& i_pts, std::vector<std::vector<iv::vec3>>& o_pts, Scratch& scratch) const;
+
+	// Contiguous output, o_buf keeps its capacity between calls.
+	void CreateStentFrame(const std::vector<Vec3>& i_pts, FrameBuffer& o_buf);
+	void CreateStentFrame(const std::vector<Vec3>& i_pts, FrameBuffer& o_buf, Scratch& scratch) const;
+
+	// Writes the rings back to back into o_pts, which must hold
+	// GetFrameCnt(i_pts) * GetRingPtCnt() points.
+	// maxPtCnt: capacity of o_pts in points.
+	// return: count of rings written, -1 if o_pts is too small, which
+	//         includes rings that need more than INT_MAX points.
+	int CreateStentFrame(const std::vector<Vec3>& i_pts, iv::vec3* o_pts, int maxPtCnt, Scratch& scratch) const;
+
+	// Same for ptCnt center-line points at i_pts, which are only read, e.g.
+	// the mapping of a CenterlineReader.
+	void CreateStentFrame(const Vec3* i_pts, int ptCnt, FrameBuffer& o_buf);
+	void CreateStentFrame(const Vec3* i_pts, int ptCnt, FrameBuffer& o_buf, Scratch& scratch) const;
+	int CreateStentFrame(const Vec3* i_pts, int ptCnt, iv::vec3* o_pts, int maxPtCnt, Scratch& scratch) const;
+
+	// Generates a stent from a center line pushed in pieces, e.g. the chunks
+	// of a CenterlineReader. Rings go to sink in chunks as soon as their
+	// frames are known, so neither the spline nor the frames or rings of the
+	// whole center line are ever held. The rings are those CreateStentFrame
+	// makes from all pushed points, in RotateScan mode up to rounding.
+	// ptCnt: points that will be pushed in total, -1 if unknown. Only
+	//        SampleGap spline fitting needs it, EndStream then checks it.
+	// chunkRingCnt: most rings per sink call.
+	// return: false in the modes that can't stream: ArcLength without a
+	//         spacing needs the spline length before placing the first ring,
+	//         SampleGap needs ptCnt.
+	bool BeginStream(Stream& stream, long long ptCnt, int chunkRingCnt, const RingSink& sink) const;
+
+	// i_pts: the next ptCnt center-line points, only read during the call.
+	// return: false once the sink or EndStream has stopped the stream.
+	bool PushStream(Stream& stream, const Vec3* i_pts, int ptCnt) const;
+
+	// Emits the rings that waited for the end of the center line.
+	// return: false if the stream was stopped or got a different point
+	//         count than announced.
+	bool EndStream(Stream& stream) const;
+
+	// Moves io_pts[k] to pos and regenerates only what depends on it.
+	// io_pts, io_buf and scratch must hold the input and result of the last
+	// CreateStentFrame(io_pts, io_buf, scratch), otherwise this falls back
+	// to a full CreateStentFrame. The spline only changes in segments
+	// k-2 .. k+1 and the rings before them are kept. Every ring after them
+	// is rewritten though, since the new frames there differ from the old
+	// ones by a twist about T. ArcLength mode shifts all later rings along
+	// the spline and always takes the full path.
+	// return: index of the first rewritten ring, io_buf.RingCnt if none.
+	int UpdateControlPoint(std::vector<Vec3>& io_pts, int k, const Vec3& pos, FrameBuffer& io_buf);
+	int UpdateControlPoint(std::vector<Vec3>& io_pts, int k, const Vec3& pos, FrameBuffer& io_buf, Scratch& scratch) const;
+
+	// Grows scratch and o_buf for inputs of up to ptCnt points, so even the
+	// first call of that size doesn't allocate. In ArcLength mode with a
+	// spacing the ring count isn't known up front and o_buf is left alone.
+	void Reserve(int ptCnt, Scratch& scratch, FrameBuffer& o_buf) const;
+
+	// Points per ring, the first point is repeated at the end.
+	int GetRingPtCnt() const { return m_SampleCnt * m_PeriodCnt + 1; }
+
+	// Count of rings CreateStentFrame emits for an input of ptCnt points.
+	// -1 in ArcLength mode with a spacing, where it depends on the shape.
+	int GetFrameCnt(int ptCnt) const;
+
+	// Count of rings CreateStentFrame emits for i_pts, any mode.
+	int GetFrameCnt(const std::vector<Vec3>& i_pts) const;
+	int GetFrameCnt(const Vec3* i_pts, int ptCnt) const;
+
+	// Only used with splineFit.
+	// mode: SampleGap is the default.
+	// spacing: for ArcLength, distance between rings along the spline.
+	//          0 splits the spline into equal parts instead.
+	void SetResampleMode(ResampleMode mode, float spacing);
+
+	// mode: RotateFrame is the default.
+	void SetFrameMode(FrameMode mode);
+
+	// pool: rings of every CreateStentFrame and UpdateControlPoint call are
+	// then generated on it, each thread writing its own rings. Not owned,
+	// 0 (the default) generates them on the calling thread. The output is
+	// the same either way, but each call then allocates the pool's job.
+	void SetThreadPool(ThreadPool* pool) { m_Pool = pool; }
+	ThreadPool* GetThreadPool() const { return m_Pool; }
+
+	int GetSampleCnt() const { return m_SampleCnt; }
+	int GetPeriodCnt() const { return m_PeriodCnt; }
+	float GetXzScale() const { return m_xzScale; }
+	float GetYScale() const { return m_yScale; }
+	bool IsSplineFit() const { return m_SplineFit; }
+	ResampleMode GetResampleMode() const { return m_ResampleMode; }
+	float GetRingSpacing() const { return m_RingSpacing; }
+	FrameMode GetFrameMode() const { return m_FrameMode; }
 
 private:
+	// Bench/StentBench.cpp times the private stages one by one.
+	friend class StentFrameBench;
+
 	void CacheSinsAndCoss();
-	std::vector<iv::vec3> CreateStentLine(const TNB& tnb, float xzScale, float yScale);
-	void UpdateTNBFrames(const std::vector<iv::vec3>& pts);
+	void CreateStentLine(const TNB& tnb, iv::vec3* o_pts) const;
+	// Rings first .. last - 1 of frames, ring i written to ringPts(i), on
+	// the pool if there is one.
+	template<class RingPts>
+	void CreateStentLines(const std::vector<TNB>& frames, int first, int last, RingPts ringPts) const;
+	// Ring i written to o_pts + (i - first) * GetRingPtCnt().
+	void CreateStentLines(const std::vector<TNB>& frames, int first, int last, iv::vec3* o_pts) const;
+	void UpdateFrames(const Vec3* i_pts, int ptCnt, Scratch& scratch) const;
+	void SampleSpline(const Vec3* i_pts, int ptCnt, Scratch& scratch) const;
+	// first: frames before it are kept, o_frames must hold them already.
+	void UpdateTNBFrames(const Vec3* pts, int ptCnt, std::vector<TNB>& o_frames, int first = 0) const;
+	// RotateScan part of UpdateTNBFrames.
+	void ScanTNBFrames(const Vec3* pts, int ptCnt, std::vector<TNB>& o_frames, int first) const;
+	// Ring origins of the stream's spline segments before segEnd.
+	void StreamSpline(Stream& stream, long long segEnd) const;
+	// ArcLength origins of the stream's next spline segment.
+	void StreamArcSegment(Stream& stream, const Vec3* ctrl) const;
+	// Frames of all pending ring origins but the last, and their rings.
+	void StreamFrames(Stream& stream) const;
 
 private:
 	int m_SampleCnt;
 	int m_PeriodCnt;
 	int m_PartCnt;
 	bool m_SplineFit;
+	ResampleMode m_ResampleMode;
+	float m_RingSpacing;
+	FrameMode m_FrameMode;
 
 	float m_xzScale;
 	float m_yScale;
 
-	std::vector<float> m_CachedSins;
-	std::vector<float> m_CachedCoss;
-	std::vector<float> m_CachedSins2;
-	std::vector<float> m_CachedCoss2;
+	std::shared_ptr<const SinCosTable> m_SinCos;
+
+	std::shared_ptr<const RingTemplate> m_RingTemplate;
+
+	ThreadPool* m_Pool;
+
+	Scratch m_Scratch;
+};
 
-	std::vector<TNB> m_Frames;
-};
\ No newline at end of file
+typedef StentFrameGeneratorT<float> StentFrameGenerator;
+typedef StentFrameGeneratorT<double> StentFrameGeneratorD;
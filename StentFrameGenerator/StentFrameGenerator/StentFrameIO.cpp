@@ -0,0 +1,588 @@
+#include "StentFrameIO.h"
+#include "StentFrameGenerator.h"
+
+#include <algorithm>
+#include <climits>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(StentFrameHeader) == 48, "header layout is part of the file format");
+static_assert(sizeof(CenterlineHeader) == 16, "header layout is part of the file format");
+static_assert(sizeof(iv::vec3) == 12, "points are stored as three packed floats");
+
+namespace
+{
+	const int s_WordCnt = (sizeof(StentFrameHeader) - 4) / 4;
+
+	bool IsLittleEndian()
+	{
+		const uint32_t one = 1;
+		return *reinterpret_cast<const unsigned char*>(&one) == 1;
+	}
+
+	// Reverses the bytes of cnt 4 byte words in place.
+	void SwapWords(void* data, size_t cnt)
+	{
+		unsigned char* p = static_cast<unsigned char*>(data);
+		for (size_t i = 0; i < cnt; ++i, p += 4)
+		{
+			unsigned char t0 = p[0], t1 = p[1];
+			p[0] = p[3];
+			p[1] = p[2];
+			p[2] = t1;
+			p[3] = t0;
+		}
+	}
+
+	// Everything after the magic is 4 byte words.
+	void SwapHeader(StentFrameHeader& header)
+	{
+		SwapWords(&header.Version, s_WordCnt);
+	}
+
+	void SwapHeader(CenterlineHeader& header)
+	{
+		SwapWords(&header.Version, 1);
+		unsigned char* p = reinterpret_cast<unsigned char*>(&header.PtCnt);
+		std::reverse(p, p + sizeof(header.PtCnt));
+	}
+
+	bool IsNumberChar(char c)
+	{
+		return (c >= '0' && c <= '9') || c == '.' || c == '-' || c == '+' || c == 'e' || c == 'E';
+	}
+
+	// Moves p past white space, empty lines and # comments.
+	void SkipBlankLines(const char*& p, const char* end)
+	{
+		while (p < end)
+		{
+			if (*p == '#')
+			{
+				while (p < end && *p != '\n')
+					++p;
+			}
+			else if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+				++p;
+			else
+				break;
+		}
+	}
+
+	// Reads x y z from the line at p and moves p to the start of the next
+	// line. return: false if the line doesn't start with three numbers.
+	bool ParsePoint(const char*& p, const char* end, iv::vec3& o_pt)
+	{
+		float xyz[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == ','))
+				++p;
+
+			// strtof wants a terminated string, the mapping has none.
+			char token[64];
+			int len = 0;
+			while (p < end && len < (int)sizeof(token) - 1 && IsNumberChar(*p))
+				token[len++] = *p++;
+			token[len] = 0;
+			if (len == 0 || (p < end && IsNumberChar(*p)))
+				return false;
+
+			char* last;
+			xyz[i] = strtof(token, &last);
+			if (last != token + len)
+				return false;
+		}
+
+		while (p < end && *p != '\n')
+			++p;
+		if (p < end)
+			++p;
+		o_pt = iv::vec3(xyz[0], xyz[1], xyz[2]);
+		return true;
+	}
+}
+
+const char StentFrameWriter::s_Magic[4] = { 'S', 'T', 'F', 'R' };
+
+StentFrameWriter::StentFrameWriter(int bufferSize)
+	: m_Buffer(bufferSize < 4096 ? 4096 : bufferSize)
+	, m_BufferUsed(0)
+	, m_Failed(false)
+{
+	memset(&m_Header, 0, sizeof(m_Header));
+}
+
+StentFrameWriter::~StentFrameWriter()
+{
+	if (IsOpen())
+		Close();
+}
+
+template<class Type>
+StentFrameHeader StentFrameWriter::MakeHeader(const StentFrameGeneratorT<Type>& sfg)
+{
+	StentFrameHeader header;
+	memcpy(header.Magic, s_Magic, sizeof(header.Magic));
+	header.Version = s_Version;
+	header.RingCnt = 0;
+	header.RingPtCnt = sfg.GetRingPtCnt();
+	header.SampleCnt = sfg.GetSampleCnt();
+	header.PeriodCnt = sfg.GetPeriodCnt();
+	header.XzScale = sfg.GetXzScale();
+	header.YScale = sfg.GetYScale();
+	header.SplineFit = sfg.IsSplineFit() ? 1 : 0;
+	header.ResampleMode = sfg.GetResampleMode();
+	header.RingSpacing = sfg.GetRingSpacing();
+	header.FrameMode = sfg.GetFrameMode();
+	return header;
+}
+
+template StentFrameHeader StentFrameWriter::MakeHeader(const StentFrameGeneratorT<float>& sfg);
+template StentFrameHeader StentFrameWriter::MakeHeader(const StentFrameGeneratorT<double>& sfg);
+
+bool StentFrameWriter::Open(const char* path, const StentFrameHeader& header)
+{
+	if (IsOpen())
+		Close();
+
+	m_File.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_File.is_open())
+		return false;
+
+	m_Header = header;
+	memcpy(m_Header.Magic, s_Magic, sizeof(m_Header.Magic));
+	m_Header.Version = s_Version;
+	m_Header.RingCnt = 0;
+	m_BufferUsed = 0;
+	m_Failed = false;
+
+	// Placeholder, Close writes the final header.
+	StentFrameHeader placeholder = m_Header;
+	if (!IsLittleEndian())
+		SwapHeader(placeholder);
+	m_File.write(reinterpret_cast<const char*>(&placeholder), sizeof(placeholder));
+	return m_File.good();
+}
+
+bool StentFrameWriter::WriteRings(const iv::vec3* pts, int ringCnt)
+{
+	if (!IsOpen() || m_Failed || ringCnt <= 0)
+		return IsOpen() && !m_Failed && ringCnt == 0;
+
+	const char* src = reinterpret_cast<const char*>(pts);
+	size_t bytes = (size_t)ringCnt * m_Header.RingPtCnt * sizeof(iv::vec3);
+	bool swap = !IsLittleEndian();
+	while (bytes > 0)
+	{
+		// Whole points only, so big-endian hosts can swap in the buffer.
+		size_t room = (m_Buffer.size() - m_BufferUsed) / sizeof(iv::vec3) * sizeof(iv::vec3);
+		if (room == 0)
+		{
+			if (!Flush())
+				return false;
+			continue;
+		}
+
+		size_t n = bytes < room ? bytes : room;
+		memcpy(&m_Buffer[m_BufferUsed], src, n);
+		if (swap)
+			SwapWords(&m_Buffer[m_BufferUsed], n / 4);
+		m_BufferUsed += (int)n;
+		src += n;
+		bytes -= n;
+	}
+
+	m_Header.RingCnt += ringCnt;
+	return true;
+}
+
+bool StentFrameWriter::Flush()
+{
+	if (m_BufferUsed > 0)
+	{
+		m_File.write(&m_Buffer[0], m_BufferUsed);
+		m_BufferUsed = 0;
+		if (!m_File.good())
+			m_Failed = true;
+	}
+	return !m_Failed;
+}
+
+bool StentFrameWriter::Close()
+{
+	if (!IsOpen())
+		return false;
+
+	Flush();
+
+	StentFrameHeader header = m_Header;
+	if (!IsLittleEndian())
+		SwapHeader(header);
+	m_File.seekp(0);
+	m_File.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	m_File.close();
+
+	bool ok = !m_Failed && !m_File.fail();
+	m_Failed = false;
+	return ok;
+}
+
+MappedFile::MappedFile()
+	: m_Data(0)
+	, m_Size(0)
+#ifdef _WIN32
+	, m_File(INVALID_HANDLE_VALUE)
+	, m_Mapping(0)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	m_File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (m_File == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_Mapping = CreateFileMappingA(m_File, 0, PAGE_READONLY, 0, 0, 0);
+	if (m_Mapping == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_Data = static_cast<const char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_Data == 0)
+	{
+		Close();
+		return false;
+	}
+	m_Size = (size_t)size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File != INVALID_HANDLE_VALUE)
+		CloseHandle(m_File);
+	m_Data = 0;
+	m_Size = 0;
+	m_Mapping = 0;
+	m_File = INVALID_HANDLE_VALUE;
+}
+
+void MappedFile::Release(size_t offset, size_t size) const
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	size_t page = info.dwPageSize;
+	size_t begin = (offset + page - 1) / page * page;
+	size_t end = (offset + size < m_Size ? offset + size : m_Size) / page * page;
+	// Unlocking pages that aren't locked takes them out of the working set.
+	if (m_Data && begin < end)
+		VirtualUnlock(const_cast<char*>(m_Data) + begin, end - begin);
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping stays valid after the descriptor is closed.
+	void* data = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	m_Data = static_cast<const char*>(data);
+	m_Size = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+		munmap(const_cast<char*>(m_Data), m_Size);
+	m_Data = 0;
+	m_Size = 0;
+}
+
+void MappedFile::Release(size_t offset, size_t size) const
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t begin = (offset + page - 1) / page * page;
+	size_t end = (offset + size < m_Size ? offset + size : m_Size) / page * page;
+	// The mapping is private and never written, so its pages are clean and
+	// dropping them loses nothing.
+	if (m_Data && begin < end)
+		madvise(const_cast<char*>(m_Data) + begin, end - begin, MADV_DONTNEED);
+}
+
+#endif
+
+StentFrameReader::StentFrameReader()
+	: m_Pts(0)
+{
+	memset(&m_Header, 0, sizeof(m_Header));
+}
+
+bool StentFrameReader::Open(const char* path)
+{
+	Close();
+
+	if (!m_File.Open(path) || m_File.GetSize() < sizeof(StentFrameHeader))
+	{
+		Close();
+		return false;
+	}
+
+	StentFrameHeader header;
+	memcpy(&header, m_File.GetData(), sizeof(header));
+	bool swap = !IsLittleEndian();
+	if (swap)
+		SwapHeader(header);
+
+	size_t payload = (size_t)header.RingCnt * header.RingPtCnt * sizeof(iv::vec3);
+	if (memcmp(header.Magic, StentFrameWriter::s_Magic, sizeof(header.Magic)) != 0
+		|| header.Version != StentFrameWriter::s_Version
+		|| m_File.GetSize() - sizeof(StentFrameHeader) < payload)
+	{
+		Close();
+		return false;
+	}
+
+	m_Header = header;
+	const char* data = m_File.GetData() + sizeof(StentFrameHeader);
+	if (swap)
+	{
+		m_Swapped.resize((size_t)header.RingCnt * header.RingPtCnt);
+		if (!m_Swapped.empty())
+		{
+			memcpy(&m_Swapped[0].x, data, payload);
+			SwapWords(&m_Swapped[0], payload / 4);
+		}
+		m_Pts = m_Swapped.empty() ? 0 : &m_Swapped[0];
+	}
+	else
+	{
+		m_Pts = reinterpret_cast<const iv::vec3*>(data);
+	}
+	return true;
+}
+
+void StentFrameReader::Close()
+{
+	m_File.Close();
+	memset(&m_Header, 0, sizeof(m_Header));
+	m_Pts = 0;
+	m_Swapped.clear();
+}
+
+const char CenterlineReader::s_Magic[4] = { 'S', 'T', 'C', 'L' };
+
+CenterlineReader::CenterlineReader()
+	: m_Format(Text)
+	, m_Pts(0)
+	, m_PtCnt(0)
+	, m_Cursor(0)
+{
+}
+
+bool CenterlineReader::Open(const char* path)
+{
+	Close();
+
+	if (!m_File.Open(path))
+		return false;
+
+	const char* data = m_File.GetData();
+	if (m_File.GetSize() < sizeof(CenterlineHeader) || memcmp(data, s_Magic, sizeof(s_Magic)) != 0)
+	{
+		m_Format = Text;
+		return true;
+	}
+
+	CenterlineHeader header;
+	memcpy(&header, data, sizeof(header));
+	if (!IsLittleEndian())
+		SwapHeader(header);
+
+	// Point counts are int throughout the generator.
+	if (header.Version != s_Version || header.PtCnt > INT_MAX
+		|| (m_File.GetSize() - sizeof(CenterlineHeader)) / sizeof(iv::vec3) < header.PtCnt)
+	{
+		Close();
+		return false;
+	}
+
+	m_Format = Binary;
+	m_PtCnt = (size_t)header.PtCnt;
+	if (IsLittleEndian() && m_PtCnt > 0)
+		m_Pts = reinterpret_cast<const iv::vec3*>(data + sizeof(CenterlineHeader));
+	return true;
+}
+
+void CenterlineReader::Close()
+{
+	m_File.Close();
+	m_Format = Text;
+	m_Pts = 0;
+	m_PtCnt = 0;
+	m_Cursor = 0;
+	m_Chunk.clear();
+}
+
+int CenterlineReader::ReadChunk(int maxPtCnt, int overlap, const iv::vec3*& o_pts)
+{
+	o_pts = 0;
+	if (!m_File.GetData() || maxPtCnt <= 0)
+		return 0;
+
+	overlap = std::max(0, std::min(overlap, maxPtCnt - 1));
+	if (m_Format == Binary)
+		return ReadBinaryChunk(maxPtCnt, overlap, o_pts);
+	return ReadTextChunk(maxPtCnt, overlap, o_pts);
+}
+
+int CenterlineReader::ReadBinaryChunk(int maxPtCnt, int overlap, const iv::vec3*& o_pts)
+{
+	if (m_Cursor >= m_PtCnt)
+		return 0;
+
+	size_t first = m_Cursor - std::min((size_t)overlap, m_Cursor);
+	size_t cnt = std::min((size_t)maxPtCnt, m_PtCnt - first);
+	m_Cursor = first + cnt;
+	m_File.Release(0, sizeof(CenterlineHeader) + first * sizeof(iv::vec3));
+
+	const char* data = m_File.GetData() + sizeof(CenterlineHeader) + first * sizeof(iv::vec3);
+	if (IsLittleEndian())
+	{
+		o_pts = reinterpret_cast<const iv::vec3*>(data);
+		return (int)cnt;
+	}
+
+	m_Chunk.resize(cnt);
+	memcpy(&m_Chunk[0].x, data, cnt * sizeof(iv::vec3));
+	SwapWords(&m_Chunk[0], cnt * 3);
+	o_pts = &m_Chunk[0];
+	return (int)cnt;
+}
+
+int CenterlineReader::ReadTextChunk(int maxPtCnt, int overlap, const iv::vec3*& o_pts)
+{
+	// The overlap is the tail of the last chunk, still in m_Chunk.
+	int keep = std::min(overlap, (int)m_Chunk.size());
+	if (keep > 0 && keep < (int)m_Chunk.size())
+		std::copy(m_Chunk.end() - keep, m_Chunk.end(), m_Chunk.begin());
+	m_Chunk.resize(keep);
+	m_Chunk.reserve(maxPtCnt);
+
+	const char* data = m_File.GetData();
+	const char* end = data + m_File.GetSize();
+	const char* p = data + m_Cursor;
+	int readCnt = 0;
+	while ((int)m_Chunk.size() < maxPtCnt)
+	{
+		SkipBlankLines(p, end);
+		if (p == end)
+			break;
+
+		iv::vec3 pt;
+		if (!ParsePoint(p, end, pt))
+			return -1;
+		m_Chunk.push_back(pt);
+		++readCnt;
+	}
+
+	m_Cursor = p - data;
+	m_File.Release(0, m_Cursor);
+	if (readCnt == 0)
+		return 0;
+
+	o_pts = &m_Chunk[0];
+	return (int)m_Chunk.size();
+}
+
+void CenterlineReader::Rewind()
+{
+	m_Cursor = 0;
+	m_Chunk.clear();
+}
+
+bool CenterlineReader::WriteBinary(const char* path, const iv::vec3* pts, size_t ptCnt)
+{
+	if (ptCnt > INT_MAX)
+		return false;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	CenterlineHeader header;
+	memcpy(header.Magic, s_Magic, sizeof(header.Magic));
+	header.Version = s_Version;
+	header.PtCnt = ptCnt;
+
+	bool swap = !IsLittleEndian();
+	if (swap)
+		SwapHeader(header);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	if (!swap)
+		file.write(reinterpret_cast<const char*>(pts), ptCnt * sizeof(iv::vec3));
+	else
+	{
+		iv::vec3 block[1024];
+		for (size_t i = 0; i < ptCnt; i += 1024)
+		{
+			size_t n = std::min((size_t)1024, ptCnt - i);
+			memcpy(&block[0].x, pts + i, n * sizeof(iv::vec3));
+			SwapWords(block, n * 3);
+			file.write(reinterpret_cast<const char*>(block), n * sizeof(iv::vec3));
+		}
+	}
+
+	file.close();
+	return !file.fail();
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <stdint.h>
+#include <fstream>
+#include <vector>
+#include "SiMath.h"
+
+template<class Type> class StentFrameGeneratorT;
+
+/* Binary stent file, replaces the tab separated result.txt.
+ *
+ * A 48 byte StentFrameHeader followed by RingCnt * RingPtCnt points, each
+ * three little-endian floats x, y, z, rings back to back. The payload
+ * starts 16 byte aligned and is mapped as is by StentFrameReader.
+ */
+
+/* example */
+/*
+	StentFrameWriter writer;
+	writer.Open("result.stf", StentFrameWriter::MakeHeader(sfg));
+	writer.WriteRings(&buf.Pts[0], buf.RingCnt);
+	writer.Close();
+
+	StentFrameReader reader;
+	reader.Open("result.stf");
+	const vec3* ring = reader.GetRing(0);
+*/
+
+struct StentFrameHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t RingCnt;
+	uint32_t RingPtCnt;
+	// Generator parameters the rings were made with.
+	uint32_t SampleCnt;
+	uint32_t PeriodCnt;
+	float XzScale;
+	float YScale;
+	uint32_t SplineFit;
+	uint32_t ResampleMode;
+	float RingSpacing;
+	uint32_t FrameMode;
+};
+
+// Buffered writer, rings can be streamed in as they are generated. The ring
+// count in the header is filled in by Close.
+class StentFrameWriter
+{
+public:
+	static const char s_Magic[4];
+	static const uint32_t s_Version = 1;
+
+	// bufferSize: bytes collected before each write to the file.
+	explicit StentFrameWriter(int bufferSize = 1 << 20);
+
+	~StentFrameWriter();
+
+	// Header of sfg's parameters, ring count 0.
+	template<class Type>
+	static StentFrameHeader MakeHeader(const StentFrameGeneratorT<Type>& sfg);
+
+	// header: RingCnt is ignored.
+	bool Open(const char* path, const StentFrameHeader& header);
+
+	// pts: ringCnt * header.RingPtCnt points.
+	bool WriteRings(const iv::vec3* pts, int ringCnt);
+
+	// Flushes and patches the ring count. return: false if any write failed.
+	bool Close();
+
+	bool IsOpen() const { return m_File.is_open(); }
+
+private:
+	StentFrameWriter(const StentFrameWriter&);
+	StentFrameWriter& operator=(const StentFrameWriter&);
+
+	bool Flush();
+
+private:
+	std::ofstream m_File;
+	StentFrameHeader m_Header;
+	std::vector<char> m_Buffer;
+	int m_BufferUsed;
+	bool m_Failed;
+};
+
+// Read-only view of a whole file in memory, POSIX mmap or a Windows file
+// mapping.
+class MappedFile
+{
+public:
+	MappedFile();
+
+	~MappedFile();
+
+	bool Open(const char* path);
+
+	void Close();
+
+	// Drops the whole pages of bytes offset .. offset + size - 1 from
+	// memory. They stay mapped and are read from the file again if touched,
+	// so a sequential reader can pass through files larger than RAM.
+	void Release(size_t offset, size_t size) const;
+
+	const char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+private:
+	const char* m_Data;
+	size_t m_Size;
+#ifdef _WIN32
+	void* m_File;
+	void* m_Mapping;
+#endif
+};
+
+// Maps a StentFrameWriter file. Rings point straight into the mapping on
+// little-endian hosts, nothing is copied or parsed.
+class StentFrameReader
+{
+public:
+	StentFrameReader();
+
+	// return: false if the file is missing, truncated or not a stent file.
+	bool Open(const char* path);
+
+	void Close();
+
+	const StentFrameHeader& GetHeader() const { return m_Header; }
+	int GetRingCnt() const { return (int)m_Header.RingCnt; }
+	int GetRingPtCnt() const { return (int)m_Header.RingPtCnt; }
+
+	// All points, ring i starts at i * GetRingPtCnt().
+	const iv::vec3* GetPts() const { return m_Pts; }
+	const iv::vec3* GetRing(int i) const { return m_Pts + (size_t)i * m_Header.RingPtCnt; }
+
+private:
+	MappedFile m_File;
+	StentFrameHeader m_Header;
+	const iv::vec3* m_Pts;
+	// Byte swapped copy of the points on big-endian hosts.
+	std::vector<iv::vec3> m_Swapped;
+};
+
+/* Center-line point files, the input of the generator.
+ *
+ * Binary: a 16 byte CenterlineHeader followed by PtCnt points, each three
+ * little-endian floats x, y, z.
+ * Text: one point per line, x y z separated by spaces, tabs or commas.
+ * Further columns, e.g. a vessel radius, are ignored. Empty lines and
+ * lines starting with # are skipped.
+ */
+
+/* example */
+/*
+	CenterlineReader reader;
+	reader.Open("aorta.scl");
+
+	// Binary files are used in place.
+	sfg.CreateStentFrame(reader.GetPts(), reader.GetPtCnt(), buf);
+
+	// Any file in pieces of a million points. A spline fitted per piece
+	// doesn't join the spline of the whole center line, the stream carries
+	// it across pieces instead.
+	sfg.BeginStream(stream, reader.GetPtCnt(), 256, sink);
+	const vec3* pts;
+	int cnt;
+	while ((cnt = reader.ReadChunk(1 << 20, 0, pts)) > 0)
+		sfg.PushStream(stream, pts, cnt);
+	sfg.EndStream(stream);
+*/
+
+struct CenterlineHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t PtCnt;
+};
+
+// Maps a center-line file. Binary points are used straight from the
+// mapping, text is parsed from it chunk by chunk, so no file is ever read
+// into memory as a whole.
+class CenterlineReader
+{
+public:
+	enum Format
+	{
+		Binary,
+		Text
+	};
+
+	static const char s_Magic[4];
+	static const uint32_t s_Version = 1;
+
+	CenterlineReader();
+
+	// Files starting with s_Magic are binary, anything else is text.
+	// return: false if the file is missing, empty, a truncated binary file
+	// or one of more than INT_MAX points. Text is only checked by
+	// ReadChunk.
+	bool Open(const char* path);
+
+	void Close();
+
+	Format GetFormat() const { return m_Format; }
+
+	// All points of a binary file on a little-endian host, 0 for text files
+	// and big-endian hosts, which have to go through ReadChunk.
+	const iv::vec3* GetPts() const { return m_Pts; }
+
+	// Points of a binary file, -1 for text, whose points are only counted
+	// as they are read. The same convention as BeginStream's ptCnt.
+	int GetPtCnt() const { return m_Format == Binary ? (int)m_PtCnt : -1; }
+
+	// Next points in file order, valid until the next call.
+	// maxPtCnt: at most this many points, overlap included.
+	// overlap: the last points of the previous chunk repeated at the start
+	//          of this one, so a spline or frames can be carried across.
+	//          Less than maxPtCnt.
+	// The file's pages before the chunk are dropped from memory.
+	// return: count of points, 0 at the end of the file, -1 on a text line
+	//         without three numbers.
+	int ReadChunk(int maxPtCnt, int overlap, const iv::vec3*& o_pts);
+
+	// ReadChunk starts over at the first point.
+	void Rewind();
+
+	// Writes ptCnt points as a binary file, false for more than INT_MAX,
+	// which Open would reject.
+	static bool WriteBinary(const char* path, const iv::vec3* pts, size_t ptCnt);
+
+private:
+	CenterlineReader(const CenterlineReader&);
+	CenterlineReader& operator=(const CenterlineReader&);
+
+	int ReadBinaryChunk(int maxPtCnt, int overlap, const iv::vec3*& o_pts);
+	int ReadTextChunk(int maxPtCnt, int overlap, const iv::vec3*& o_pts);
+
+private:
+	MappedFile m_File;
+	Format m_Format;
+	const iv::vec3* m_Pts;
+	size_t m_PtCnt;
+	// ReadChunk position, points read for binary, bytes parsed for text.
+	size_t m_Cursor;
+	// Points of the current chunk for text files and big-endian hosts.
+	std::vector<iv::vec3> m_Chunk;
+};
@@ -0,0 +1,152 @@
+#include "StentMeshGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+StentMeshGenerator::StentMeshGenerator(Profile profile, float width, float thickness, int sideCnt)
+{
+	using namespace iv;
+
+	if (profile == Circle)
+	{
+		int n = std::max(3, sideCnt);
+		float radius = 0.5f * width;
+		for (int i = 0; i < n; ++i)
+		{
+			float rad = (float)(ivTWOPI * i / n);
+			vec2 dir(std::cos(rad), std::sin(rad));
+			m_ProfilePts.push_back(dir * radius);
+			m_ProfileNormals.push_back(dir);
+			m_ProfileEdges.push_back(i);
+			m_ProfileEdges.push_back((i + 1) % n);
+		}
+		return;
+	}
+
+	// Corners counter-clockwise around the ring tangent. Every side gets
+	// its own two vertices so the normals stay flat.
+	float h = 0.5f * thickness;
+	float w = 0.5f * width;
+	const vec2 corners[4] = { vec2(-h, -w), vec2(h, -w), vec2(h, w), vec2(-h, w) };
+	const vec2 normals[4] = { vec2(0.0f, -1.0f), vec2(1.0f, 0.0f), vec2(0.0f, 1.0f), vec2(-1.0f, 0.0f) };
+	for (int i = 0; i < 4; ++i)
+	{
+		m_ProfilePts.push_back(corners[i]);
+		m_ProfilePts.push_back(corners[(i + 1) % 4]);
+		m_ProfileNormals.push_back(normals[i]);
+		m_ProfileNormals.push_back(normals[i]);
+		m_ProfileEdges.push_back(2 * i);
+		m_ProfileEdges.push_back(2 * i + 1);
+	}
+}
+
+long long StentMeshGenerator::GetVertexCnt(int ringCnt, int ringPtCnt) const
+{
+	if (ringPtCnt < 2)
+		return 0;
+	return (long long)ringCnt * (ringPtCnt - 1) * (long long)m_ProfilePts.size();
+}
+
+long long StentMeshGenerator::GetIndexCnt(int ringCnt, int ringPtCnt) const
+{
+	if (ringPtCnt < 2)
+		return 0;
+	return (long long)ringCnt * (ringPtCnt - 1) * (long long)(m_ProfileEdges.size() / 2) * 6;
+}
+
+bool StentMeshGenerator::CreateMesh(const StentFrameGenerator::FrameBuffer& rings, const std::vector<StentFrameGenerator::TNB>& frames,
+	Mesh& o_mesh, ThreadPool* pool) const
+{
+	int ringCnt = std::min(rings.RingCnt, (int)frames.size());
+	int ringPtCnt = rings.RingPtCnt;
+	long long vertexCnt = GetVertexCnt(ringCnt, ringPtCnt);
+	long long indexCnt = GetIndexCnt(ringCnt, ringPtCnt);
+
+	// Indices are uint32_t, a larger mesh would wrap them.
+	if (vertexCnt > (long long)UINT32_MAX + 1)
+	{
+		o_mesh.Positions.clear();
+		o_mesh.Normals.clear();
+		o_mesh.Indices.clear();
+		return false;
+	}
+
+	o_mesh.Positions.resize((size_t)vertexCnt);
+	o_mesh.Normals.resize((size_t)vertexCnt);
+	o_mesh.Indices.resize((size_t)indexCnt);
+	if (vertexCnt == 0)
+		return true;
+
+	// Every ring owns a fixed slice of each buffer, so rings can be meshed
+	// in any order on any thread.
+	size_t ringVertexCnt = (size_t)(vertexCnt / ringCnt);
+	size_t ringIndexCnt = (size_t)(indexCnt / ringCnt);
+	auto meshRings = [&](int begin, int end, int /*slot*/)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			CreateRingMesh(&rings.Pts[rings.RingOffsets[i]], ringPtCnt - 1, frames[i], (uint32_t)(i * ringVertexCnt),
+				&o_mesh.Positions[i * ringVertexCnt], &o_mesh.Normals[i * ringVertexCnt], &o_mesh.Indices[i * ringIndexCnt]);
+		}
+	};
+
+	if (pool)
+		pool->ParallelFor(ringCnt, 1, meshRings);
+	else
+		meshRings(0, ringCnt, 0);
+	return true;
+}
+
+void StentMeshGenerator::CreateRingMesh(const iv::vec3* ringPts, int ptCnt, const StentFrameGenerator::TNB& frame,
+	uint32_t baseVertex, iv::vec3* o_positions, iv::vec3* o_normals, uint32_t* o_indices) const
+{
+	using namespace iv;
+
+	int profileCnt = m_ProfilePts.size();
+	int edgeCnt = m_ProfileEdges.size() / 2;
+
+	for (int j = 0; j < ptCnt; ++j)
+	{
+		const vec3& p = ringPts[j];
+		const vec3& prev = ringPts[(j + ptCnt - 1) % ptCnt];
+		const vec3& next = ringPts[(j + 1) % ptCnt];
+
+		// t along the ring, u away from the vessel axis, v = t x u along
+		// the wall, so (u, v, t) is right-handed.
+		vec3 t = normalize(next - prev);
+		vec3 r = p - frame.O;
+		r = r - frame.T * dot(r, frame.T);
+		vec3 u = normalize(r - t * dot(r, t));
+		vec3 v = cross(t, u);
+
+		vec3* pos = o_positions + j * profileCnt;
+		vec3* nrm = o_normals + j * profileCnt;
+		for (int k = 0; k < profileCnt; ++k)
+		{
+			const vec2& pp = m_ProfilePts[k];
+			const vec2& pn = m_ProfileNormals[k];
+			pos[k] = p + u * pp.x + v * pp.y;
+			nrm[k] = u * pn.x + v * pn.y;
+		}
+	}
+
+	// Profile edges run counter-clockwise around t, so a -> b -> b' and
+	// a -> b' -> a' face outward.
+	uint32_t* idx = o_indices;
+	for (int j = 0; j < ptCnt; ++j)
+	{
+		uint32_t s0 = baseVertex + (uint32_t)(j * profileCnt);
+		uint32_t s1 = baseVertex + (uint32_t)(((j + 1) % ptCnt) * profileCnt);
+		for (int e = 0; e < edgeCnt; ++e)
+		{
+			uint32_t a = (uint32_t)m_ProfileEdges[2 * e];
+			uint32_t b = (uint32_t)m_ProfileEdges[2 * e + 1];
+			*idx++ = s0 + a;
+			*idx++ = s0 + b;
+			*idx++ = s1 + b;
+			*idx++ = s0 + a;
+			*idx++ = s1 + b;
+			*idx++ = s1 + a;
+		}
+	}
+}
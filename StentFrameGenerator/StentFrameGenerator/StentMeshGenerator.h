@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "SiMath.h"
+#include "StentFrameGenerator.h"
+#include "ThreadPool.h"
+
+/* example */
+/*
+	StentFrameGenerator sfg(32, 12, 0.1f, 0.02f, true);
+	StentFrameGenerator::Scratch scratch;
+	StentFrameGenerator::FrameBuffer rings;
+	sfg.CreateStentFrame(pts, rings, scratch);
+
+	StentMeshGenerator smg(StentMeshGenerator::Rectangle, 0.01f, 0.005f, 0);
+	StentMeshGenerator::Mesh mesh;
+	smg.CreateMesh(rings, scratch.Frames, mesh, &pool);
+*/
+
+// Sweeps a strut cross-section along every ring of a stent and emits an
+// indexed triangle mesh. The cross-section is oriented by the ring tangent
+// and the direction from the ring's frame origin, so its first axis always
+// points away from the vessel axis.
+class StentMeshGenerator
+{
+public:
+	enum Profile
+	{
+		// Round wire, smooth normals.
+		Circle,
+		// Laser cut strut, flat sides with their own vertices.
+		Rectangle
+	};
+
+	struct Mesh
+	{
+		std::vector<iv::vec3> Positions;
+		std::vector<iv::vec3> Normals;
+		// Counter-clockwise triangles seen from outside the strut.
+		std::vector<uint32_t> Indices;
+	};
+
+	// width: strut size along the vessel wall, the diameter for Circle.
+	// thickness: strut size away from the vessel axis, unused for Circle.
+	// sideCnt: vertices around a Circle cross-section, at least 3.
+	// Struts wider than the bend radius at the ring crowns fold over there.
+	StentMeshGenerator(Profile profile, float width, float thickness, int sideCnt);
+
+	// Vertex and index counts of a mesh for ringCnt rings of ringPtCnt
+	// points, the repeated closing point included.
+	long long GetVertexCnt(int ringCnt, int ringPtCnt) const;
+	long long GetIndexCnt(int ringCnt, int ringPtCnt) const;
+
+	// rings, frames: result and Scratch::Frames of one CreateStentFrame call.
+	// pool: rings are meshed in parallel on it, 0 runs on the calling thread.
+	// o_mesh is resized to the exact counts up front and keeps its capacity.
+	// return: false if the mesh has more vertices than uint32_t indices
+	//         address, o_mesh is then left empty.
+	bool CreateMesh(const StentFrameGenerator::FrameBuffer& rings, const std::vector<StentFrameGenerator::TNB>& frames,
+		Mesh& o_mesh, ThreadPool* pool) const;
+
+private:
+	void CreateRingMesh(const iv::vec3* ringPts, int ptCnt, const StentFrameGenerator::TNB& frame,
+		uint32_t baseVertex, iv::vec3* o_positions, iv::vec3* o_normals, uint32_t* o_indices) const;
+
+private:
+	// Cross-section in (outward, along wall) coordinates, with the normal of
+	// each vertex in the same plane.
+	std::vector<iv::vec2> m_ProfilePts;
+	std::vector<iv::vec2> m_ProfileNormals;
+	// Pairs of profile vertices, each swept into a quad between sections.
+	std::vector<int> m_ProfileEdges;
+};
@@ -0,0 +1,199 @@
+#include "StentProfiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	struct TraceEvent
+	{
+		StentProfiler::Stage Stage;
+		int Thread;
+		long long StartNs;
+		long long DurationNs;
+	};
+
+	// Totals are plain relaxed atomics, a stage call costs two clock reads
+	// and two additions.
+	struct ProfilerState
+	{
+		std::atomic<long long> Nanoseconds[StentProfiler::StageCnt];
+		std::atomic<long long> Calls[StentProfiler::StageCnt];
+		std::atomic<long long> Counters[StentProfiler::CounterCnt];
+		std::atomic<bool> TraceEnabled;
+		std::atomic<int> ThreadCnt;
+		Clock::time_point Epoch;
+
+		std::mutex TraceMutex;
+		std::vector<TraceEvent> Trace;
+
+		ProfilerState() : TraceEnabled(false), ThreadCnt(0), Epoch(Clock::now())
+		{
+			for (int i = 0; i < StentProfiler::StageCnt; ++i)
+			{
+				Nanoseconds[i] = 0;
+				Calls[i] = 0;
+			}
+			for (int i = 0; i < StentProfiler::CounterCnt; ++i)
+				Counters[i] = 0;
+		}
+	};
+
+	// Created on first use, also from static initializers.
+	ProfilerState& GetState()
+	{
+		static ProfilerState s_State;
+		return s_State;
+	}
+
+	// Small thread numbers for the trace, in order of first event.
+	int GetThreadIndex()
+	{
+		static thread_local int t_Index = -1;
+		if (t_Index < 0)
+			t_Index = GetState().ThreadCnt++;
+		return t_Index;
+	}
+}
+
+StentProfiler::Stats StentProfiler::GetStats()
+{
+	ProfilerState& state = GetState();
+	Stats st;
+	for (int i = 0; i < StageCnt; ++i)
+	{
+		st.Seconds[i] = state.Nanoseconds[i].load(std::memory_order_relaxed) * 1e-9;
+		st.Calls[i] = state.Calls[i].load(std::memory_order_relaxed);
+	}
+	for (int i = 0; i < CounterCnt; ++i)
+		st.Counters[i] = state.Counters[i].load(std::memory_order_relaxed);
+	return st;
+}
+
+void StentProfiler::Reset()
+{
+	ProfilerState& state = GetState();
+	for (int i = 0; i < StageCnt; ++i)
+	{
+		state.Nanoseconds[i] = 0;
+		state.Calls[i] = 0;
+	}
+	for (int i = 0; i < CounterCnt; ++i)
+		state.Counters[i] = 0;
+
+	std::lock_guard<std::mutex> lock(state.TraceMutex);
+	state.Trace.clear();
+}
+
+void StentProfiler::SetTraceEnabled(bool enabled)
+{
+	GetState().TraceEnabled = enabled;
+}
+
+bool StentProfiler::WriteChromeTrace(const char* path)
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+		return false;
+
+	// Chrome trace times are microseconds, written with nanosecond
+	// resolution.
+	ProfilerState& state = GetState();
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[";
+
+	long long lastNs = 0;
+	{
+		std::lock_guard<std::mutex> lock(state.TraceMutex);
+		for (size_t i = 0; i < state.Trace.size(); ++i)
+		{
+			const TraceEvent& e = state.Trace[i];
+			file << (i == 0 ? "\n" : ",\n");
+			file << "{\"name\":\"" << GetStageName(e.Stage) << "\",\"cat\":\"stent\",\"ph\":\"X\",\"pid\":1"
+				<< ",\"tid\":" << e.Thread
+				<< ",\"ts\":" << e.StartNs * 1e-3
+				<< ",\"dur\":" << e.DurationNs * 1e-3 << "}";
+			lastNs = std::max(lastNs, e.StartNs + e.DurationNs);
+		}
+		file << (state.Trace.empty() ? "\n" : ",\n");
+	}
+
+	Stats st = GetStats();
+	file << "{\"name\":\"totals\",\"cat\":\"stent\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":" << lastNs * 1e-3 << ",\"args\":{";
+	for (int i = 0; i < CounterCnt; ++i)
+		file << (i == 0 ? "" : ",") << "\"" << GetCounterName((Counter)i) << "\":" << st.Counters[i];
+	file << "}}\n],\"otherData\":{";
+	for (int i = 0; i < StageCnt; ++i)
+	{
+		file << (i == 0 ? "" : ",") << "\"" << GetStageName((Stage)i) << "_ns\":" << state.Nanoseconds[i].load(std::memory_order_relaxed)
+			<< ",\"" << GetStageName((Stage)i) << "_calls\":" << st.Calls[i];
+	}
+	file << "}}\n";
+
+	file.close();
+	return !file.fail();
+}
+
+const char* StentProfiler::GetStageName(Stage stage)
+{
+	switch (stage)
+	{
+	case Spline:
+		return "spline";
+	case Resample:
+		return "resample";
+	case Frames:
+		return "frames";
+	case Rings:
+		return "rings";
+	default:
+		return "unknown";
+	}
+}
+
+const char* StentProfiler::GetCounterName(Counter counter)
+{
+	switch (counter)
+	{
+	case PointsEmitted:
+		return "points_emitted";
+	case FramesBuilt:
+		return "frames_built";
+	case Allocations:
+		return "allocations";
+	default:
+		return "unknown";
+	}
+}
+
+void StentProfiler::Add(Counter counter, long long n)
+{
+	GetState().Counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void StentProfiler::AddTime(Stage stage, Clock::time_point start, Clock::time_point end)
+{
+	ProfilerState& state = GetState();
+	long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	state.Nanoseconds[stage].fetch_add(ns, std::memory_order_relaxed);
+	state.Calls[stage].fetch_add(1, std::memory_order_relaxed);
+
+	if (!state.TraceEnabled.load(std::memory_order_relaxed))
+		return;
+
+	TraceEvent e;
+	e.Stage = stage;
+	e.Thread = GetThreadIndex();
+	// A call already running when the state was created starts before it.
+	e.StartNs = std::max(0LL, (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(start - state.Epoch).count());
+	e.DurationNs = ns;
+
+	std::lock_guard<std::mutex> lock(state.TraceMutex);
+	state.Trace.push_back(e);
+}
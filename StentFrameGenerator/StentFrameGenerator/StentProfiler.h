@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <stddef.h>
+#include <type_traits>
+
+/* example */
+/*
+	// Build with STENT_PROFILE defined, e.g. cmake -DSTENT_ENABLE_PROFILING=ON.
+	StentProfiler::SetTraceEnabled(true);
+	sfg.CreateStentFrame(pts, buf);
+	StentProfiler::Stats st = StentProfiler::GetStats();
+	double ringSec = st.Seconds[StentProfiler::Rings];
+	StentProfiler::WriteChromeTrace("trace.json");
+*/
+
+// Process-wide stage timers and counters of the generator. The hooks in the
+// generator are the STENT_PROFILE_* macros below, which expand to nothing
+// unless STENT_PROFILE is defined, so a normal build carries no trace of
+// them. The API here always exists and reports zeros in such a build.
+// Thread-safe, totals are summed over all threads.
+class StentProfiler
+{
+public:
+	enum Stage
+	{
+		// Bezier sampling or the arc length table.
+		Spline,
+		// Picking ring positions on the spline.
+		Resample,
+		// TNB frame propagation.
+		Frames,
+		// Ring points written.
+		Rings,
+		StageCnt
+	};
+
+	enum Counter
+	{
+		PointsEmitted,
+		FramesBuilt,
+		// Generator buffers that had to grow, each growth is one heap
+		// allocation.
+		Allocations,
+		CounterCnt
+	};
+
+	struct Stats
+	{
+		double Seconds[StageCnt];
+		long long Calls[StageCnt];
+		long long Counters[CounterCnt];
+	};
+
+	static Stats GetStats();
+
+	// Zeroes the totals and drops recorded trace events.
+	static void Reset();
+
+	// Also record every stage call as a trace event. Off by default, events
+	// are kept in memory until Reset.
+	static void SetTraceEnabled(bool enabled);
+
+	// Chrome trace JSON (chrome://tracing, Perfetto): one complete event per
+	// recorded stage call and a final counter event with the totals.
+	// return: false if the file can't be written.
+	static bool WriteChromeTrace(const char* path);
+
+	static const char* GetStageName(Stage stage);
+	static const char* GetCounterName(Counter counter);
+
+	static void Add(Counter counter, long long n);
+	static void AddTime(Stage stage, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+
+	// Times its own lifetime as one call of a stage.
+	class Scope
+	{
+	public:
+		explicit Scope(Stage stage) : m_Stage(stage), m_Start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~Scope()
+		{
+			AddTime(m_Stage, m_Start, std::chrono::steady_clock::now());
+		}
+
+	private:
+		Stage m_Stage;
+		std::chrono::steady_clock::time_point m_Start;
+	};
+
+	// Counts an allocation if the vector's capacity changed during its
+	// lifetime.
+	template<class Vector>
+	class GrowthWatch
+	{
+	public:
+		explicit GrowthWatch(const Vector& v) : m_Vector(v), m_Capacity(v.capacity())
+		{
+		}
+
+		~GrowthWatch()
+		{
+			if (m_Vector.capacity() != m_Capacity)
+				Add(Allocations, 1);
+		}
+
+	private:
+		const Vector& m_Vector;
+		size_t m_Capacity;
+	};
+};
+
+#define STENT_PROFILE_CONCAT2(a, b) a##b
+#define STENT_PROFILE_CONCAT(a, b) STENT_PROFILE_CONCAT2(a, b)
+
+#ifdef STENT_PROFILE
+#define STENT_PROFILE_SCOPE(stage) StentProfiler::Scope STENT_PROFILE_CONCAT(t_StentScope, __LINE__)(StentProfiler::stage)
+#define STENT_PROFILE_COUNT(counter, n) StentProfiler::Add(StentProfiler::counter, (long long)(n))
+#define STENT_PROFILE_WATCH(vec) StentProfiler::GrowthWatch<typename std::decay<decltype(vec)>::type> STENT_PROFILE_CONCAT(t_StentWatch, __LINE__)(vec)
+#else
+#define STENT_PROFILE_SCOPE(stage)
+#define STENT_PROFILE_COUNT(counter, n)
+#define STENT_PROFILE_WATCH(vec)
+#endif
@@ -0,0 +1,123 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace
+{
+	// Pool and slot of the current thread, so nested ParallelFor calls from a
+	// worker keep reporting that worker's slot.
+	thread_local const ThreadPool* t_Pool = 0;
+	thread_local int t_Slot = 0;
+
+	struct ParallelJob
+	{
+		std::atomic<int> Next;
+		std::atomic<int> Done;
+		int Count;
+		int Grain;
+		const std::function<void(int, int, int)>* Fn;
+		std::mutex Mutex;
+		std::condition_variable Cond;
+
+		// Grab chunks until none are left. Returns once this thread can't
+		// find more work, not when the whole job is finished.
+		void Run(int slot)
+		{
+			for (;;)
+			{
+				int begin = Next.fetch_add(Grain);
+				if (begin >= Count)
+					return;
+				int end = std::min(begin + Grain, Count);
+				(*Fn)(begin, end, slot);
+				if (Done.fetch_add(end - begin) + (end - begin) == Count)
+				{
+					std::lock_guard<std::mutex> lock(Mutex);
+					Cond.notify_all();
+				}
+			}
+		}
+	};
+}
+
+ThreadPool::ThreadPool(int workerCnt) : m_Quit(false)
+{
+	if (workerCnt <= 0)
+		workerCnt = std::max(1, (int)std::thread::hardware_concurrency()) - 1;
+
+	for (int i = 0; i < workerCnt; ++i)
+		m_Workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i + 1));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_Cond.notify_all();
+	for (int i = 0; i < m_Workers.size(); ++i)
+		m_Workers[i].join();
+}
+
+void ThreadPool::WorkerLoop(int slot)
+{
+	t_Pool = this;
+	t_Slot = slot;
+
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Cond.wait(lock, [this] { return m_Quit || !m_Tasks.empty(); });
+			if (m_Tasks.empty())
+				return;
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(int count, int grain, const std::function<void(int, int, int)>& fn)
+{
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	int slot = (t_Pool == this) ? t_Slot : 0;
+	int chunkCnt = (count + grain - 1) / grain;
+	int helperCnt = std::min((int)m_Workers.size(), chunkCnt - 1);
+	if (helperCnt <= 0)
+	{
+		fn(0, count, slot);
+		return;
+	}
+
+	// The job outlives this call if a queued helper only starts after all
+	// chunks are taken, so it is shared with the helpers.
+	std::shared_ptr<ParallelJob> job = std::make_shared<ParallelJob>();
+	job->Next = 0;
+	job->Done = 0;
+	job->Count = count;
+	job->Grain = grain;
+	job->Fn = &fn;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (int i = 0; i < helperCnt; ++i)
+			m_Tasks.push_back([job] { job->Run(t_Slot); });
+	}
+	m_Cond.notify_all();
+
+	job->Run(slot);
+
+	// Only chunks already running on other threads are left, so waiting here
+	// can't deadlock even when every worker is itself inside ParallelFor.
+	std::unique_lock<std::mutex> lock(job->Mutex);
+	job->Cond.wait(lock, [&job] { return job->Done.load() == job->Count; });
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* example */
+/*
+	ThreadPool pool(0);
+	std::vector<float> v(1000);
+	pool.ParallelFor(v.size(), 64, [&](int begin, int end, int slot)
+	{
+		for (int i = begin; i < end; ++i)
+			v[i] = (float)i;
+	});
+*/
+
+class ThreadPool
+{
+public:
+	// workerCnt: count of worker threads, 0 means one per hardware thread
+	//            minus the calling thread.
+	explicit ThreadPool(int workerCnt);
+
+	~ThreadPool();
+
+	// Worker threads plus the calling thread.
+	int GetSlotCnt() const { return (int)m_Workers.size() + 1; }
+
+	// Split [0, count) into chunks of grain and run fn(begin, end, slot) on
+	// them. The calling thread takes part and the call returns when every
+	// chunk is done. slot is 0 for the calling thread and 1..workerCnt for
+	// pool threads, so callers can index per-thread scratch with it.
+	// Nested calls from inside fn are allowed.
+	void ParallelFor(int count, int grain, const std::function<void(int, int, int)>& fn);
+
+private:
+	void WorkerLoop(int slot);
+
+private:
+	std::vector<std::thread> m_Workers;
+	std::deque<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Cond;
+	bool m_Quit;
+};
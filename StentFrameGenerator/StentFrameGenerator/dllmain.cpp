@@ -1,74 +1,96 @@
-#include "StentFrameGenerator.h";
+#include "StentFrameGenerator.h"
+#include "StentFrameIO.h"
 #include "BeizerSpline.h"
+#include "StentProfiler.h"
 
 #include <fstream>
-
-#if 0
-extern "C"
-{
-	__declspec(dllexport) bool init_dll()
-	{
-		if (s_pStentFrameGenerator == 0)
-			s_pStentFrameGenerator = new StentFrameGenerator(32, 12, 12, false);
-		if (s_pBeizerGenerator == 0)
-			s_pBeizerGenerator = new BeizerSplineGenerator(0.1f);
-		return true;
-	}
-	__declspec(dllexport) void CreateBeizerLine(float* pts,int ptCnt)
-	{
-		if (s_pBeizerGenerator == 0)
-			return;
-
-		std::ofstream abc("log.txt", std::ios::ate);
-
-		std::vector<iv::vec3> ipts;
-		for (int i = 0; i < ptCnt; ++i)
-		{
-			ipts.push_back(iv::vec3(pts));
-			abc << pts[0] << "," << pts[1] << "," << pts[2] << "\n";
-			pts += 3;
-		}
-
-		abc.flush();
-		abc.close();
-
-		s_pBeizerGenerator->CreateBeizeSpline(ipts, s_BeizerPts);
-	}
-	__declspec(dllexport) float* GetPtsPtr()
-	{
-		return s_BeizerPts[0].v;
-	}
-}
-#endif
+#include <string.h>
 
 using namespace std;
 using namespace iv;
 
-int main()
+// Writes result.stf, see StentFrameIO.h. --text writes the old tab
+// separated result.txt instead. --trace also writes trace.json, which only
+// has events in a build with STENT_PROFILE defined. A center-line file, see
+// CenterlineReader, replaces the built-in points.
+int main(int argc, char** argv)
 {
+	bool text = false;
+	bool trace = false;
+	const char* input = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--text") == 0)
+			text = true;
+		else if (strcmp(argv[i], "--trace") == 0)
+			trace = true;
+		else
+			input = argv[i];
+	}
+	StentProfiler::SetTraceEnabled(trace);
+
 	StentFrameGenerator sfg(32, 12,0.1f, 0.02f, true);
 	vector<vec3> pts;
 	pts.push_back(vec3(.0f, .0f, .0f));
 	pts.push_back(vec3(1.0f, .0f, .0f));
 	pts.push_back(vec3(1.0f, 1.0f, .0f));
 	pts.push_back(vec3(1.0f, 1.0f, 1.0f));
-	vector<vector<vec3>> result;
-	sfg.CreateStentFrame(pts, result);
-	if (result.empty())
+	const vec3* inputPts = &pts[0];
+	int inputCnt = pts.size();
+
+	// Binary files are used in place, text is parsed into pts.
+	CenterlineReader reader;
+	if (input)
+	{
+		if (!reader.Open(input))
+			return -1;
+		if (reader.GetPts())
+		{
+			inputPts = reader.GetPts();
+			inputCnt = reader.GetPtCnt();
+		}
+		else
+		{
+			pts.clear();
+			const vec3* chunk;
+			int cnt;
+			while ((cnt = reader.ReadChunk(1 << 16, 0, chunk)) > 0)
+				pts.insert(pts.end(), chunk, chunk + cnt);
+			if (cnt < 0 || pts.empty())
+				return -1;
+			inputPts = &pts[0];
+			inputCnt = pts.size();
+		}
+	}
+
+	StentFrameGenerator::FrameBuffer result;
+	sfg.CreateStentFrame(inputPts, inputCnt, result);
+	if (result.RingCnt == 0)
 		return -1;
-	std::ofstream rf("result.txt", ios::ate);
-	for (int i = 0; i < result.size(); ++i)
+	if (text)
 	{
-		for (int j = 0; j < result[i].size(); ++j)
+		std::ofstream rf("result.txt", ios::ate);
+		for (int i = 0; i < (int)result.Pts.size(); ++i)
 		{
-			const vec3& p = result[i][j];
+			const vec3& p = result.Pts[i];
 			rf << p.x << "\t" << p.y << "\t" << p.z << "\n";
 		}
+		rf.close();
+	}
+	else
+	{
+		StentFrameWriter writer;
+		if (!writer.Open("result.stf", StentFrameWriter::MakeHeader(sfg))
+			|| !writer.WriteRings(&result.Pts[0], result.RingCnt)
+			|| !writer.Close())
+			return -1;
 	}
-	rf.close();
+
+	if (trace && !StentProfiler::WriteChromeTrace("trace.json"))
+		return -1;
 
 	getchar();
 	getchar();
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,69 @@
+using System;
+using System.Runtime.InteropServices;
+
+namespace StentGlue
+{
+    // Declarations of StentFrameApi.h. Every parameter is blittable, so calls
+    // pass raw pointers and nothing is marshaled per point.
+    internal static unsafe class NativeMethods
+    {
+        public const string LibraryName = "stentframe";
+
+        public const int ErrorInvalidArgument = -1;
+        public const int ErrorBufferTooSmall = -2;
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern IntPtr SfgCreateGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, int splineFit);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern void SfgDestroyGenerator(IntPtr gen);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SfgSetResampleMode(StentFrameGeneratorHandle gen, int mode, float spacing);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SfgSetFrameMode(StentFrameGeneratorHandle gen, int mode);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SfgGetRingPointCount(StentFrameGeneratorHandle gen);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SfgGetFrameCount(StentFrameGeneratorHandle gen, float* pts, int ptCnt);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SfgCreateStentFrame(StentFrameGeneratorHandle gen, float* pts, int ptCnt, float* outPts, int outPtCapacity);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SfgGetBeizerLinePointCount(float step, int ptCnt);
+
+        [DllImport(LibraryName, CallingConvention = CallingConvention.Cdecl)]
+        public static extern int SfgCreateBeizerLine(float step, float* pts, int ptCnt, float* outPts, int outPtCapacity);
+    }
+
+    // Owns a native SfgGenerator and destroys it exactly once.
+    internal sealed class StentFrameGeneratorHandle : SafeHandle
+    {
+        public StentFrameGeneratorHandle()
+            : base(IntPtr.Zero, true)
+        {
+        }
+
+        public override bool IsInvalid
+        {
+            get { return handle == IntPtr.Zero; }
+        }
+
+        public static StentFrameGeneratorHandle Create(int sampleCnt, int periodCnt, float xzScale, float yScale, bool splineFit)
+        {
+            StentFrameGeneratorHandle h = new StentFrameGeneratorHandle();
+            h.SetHandle(NativeMethods.SfgCreateGenerator(sampleCnt, periodCnt, xzScale, yScale, splineFit ? 1 : 0));
+            return h;
+        }
+
+        protected override bool ReleaseHandle()
+        {
+            NativeMethods.SfgDestroyGenerator(handle);
+            return true;
+        }
+    }
+}
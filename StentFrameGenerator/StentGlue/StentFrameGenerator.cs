@@ -0,0 +1,129 @@
+using System;
+using System.Numerics;
+using System.Runtime.InteropServices;
+
+namespace StentGlue
+{
+    public enum ResampleMode
+    {
+        SampleGap = 0,
+        ArcLength = 1,
+    }
+
+    public enum FrameMode
+    {
+        RotateFrame = 0,
+        DoubleReflection = 1,
+        RotateScan = 2,
+    }
+
+    /* Managed view of the native stent generator.
+     *
+     * Points are packed x, y, z floats. Center lines and rings cross the
+     * boundary as pinned spans, the native side reads and writes them in
+     * place. Calls on one instance are serialized natively, use one instance
+     * per thread for parallel generation.
+     *
+     * example:
+     *
+     *  using (StentFrameGenerator sfg = new StentFrameGenerator(32, 12, 0.1f, 0.02f, true))
+     *  {
+     *      float[] rings = new float[sfg.GetFrameCount(pts) * sfg.RingPointCount * 3];
+     *      int ringCnt = sfg.CreateStentFrame(pts, rings);
+     *  }
+     */
+    public sealed unsafe class StentFrameGenerator : IDisposable
+    {
+        private readonly StentFrameGeneratorHandle m_Handle;
+
+        // Parameters as in the native StentFrameGenerator.
+        public StentFrameGenerator(int sampleCnt, int periodCnt, float xzScale, float yScale, bool splineFit)
+        {
+            m_Handle = StentFrameGeneratorHandle.Create(sampleCnt, periodCnt, xzScale, yScale, splineFit);
+            if (m_Handle.IsInvalid)
+                throw new ArgumentException("invalid stent parameters");
+        }
+
+        // Points per ring, the first point is repeated at the end.
+        public int RingPointCount
+        {
+            get { return NativeMethods.SfgGetRingPointCount(m_Handle); }
+        }
+
+        public void SetResampleMode(ResampleMode mode, float spacing)
+        {
+            Check(NativeMethods.SfgSetResampleMode(m_Handle, (int)mode, spacing));
+        }
+
+        public void SetFrameMode(FrameMode mode)
+        {
+            Check(NativeMethods.SfgSetFrameMode(m_Handle, (int)mode));
+        }
+
+        // Count of rings CreateStentFrame returns for these points.
+        public int GetFrameCount(ReadOnlySpan<float> pts)
+        {
+            fixed (float* p = pts)
+                return Check(NativeMethods.SfgGetFrameCount(m_Handle, p, PointCount(pts)));
+        }
+
+        // pts: center line points.
+        // rings: receives the rings back to back, GetFrameCount * RingPointCount points.
+        // return: count of rings written.
+        public int CreateStentFrame(ReadOnlySpan<float> pts, Span<float> rings)
+        {
+            fixed (float* p = pts)
+            fixed (float* r = rings)
+                return Check(NativeMethods.SfgCreateStentFrame(m_Handle, p, PointCount(pts), r, rings.Length / 3));
+        }
+
+        public int CreateStentFrame(ReadOnlySpan<Vector3> pts, Span<Vector3> rings)
+        {
+            return CreateStentFrame(MemoryMarshal.Cast<Vector3, float>(pts), MemoryMarshal.Cast<Vector3, float>(rings));
+        }
+
+        // Same, allocating the result.
+        public float[] CreateStentFrame(ReadOnlySpan<float> pts)
+        {
+            float[] rings = new float[GetFrameCount(pts) * RingPointCount * 3];
+            int ringCnt = CreateStentFrame(pts, rings);
+            if (ringCnt * RingPointCount * 3 != rings.Length)
+                Array.Resize(ref rings, ringCnt * RingPointCount * 3);
+            return rings;
+        }
+
+        // Beizer spline through pts sampled with step.
+        public static int GetBeizerLinePointCount(float step, int ptCnt)
+        {
+            return Check(NativeMethods.SfgGetBeizerLinePointCount(step, ptCnt));
+        }
+
+        public static int CreateBeizerLine(float step, ReadOnlySpan<float> pts, Span<float> line)
+        {
+            fixed (float* p = pts)
+            fixed (float* l = line)
+                return Check(NativeMethods.SfgCreateBeizerLine(step, p, PointCount(pts), l, line.Length / 3));
+        }
+
+        public void Dispose()
+        {
+            m_Handle.Dispose();
+        }
+
+        private static int PointCount(ReadOnlySpan<float> pts)
+        {
+            if (pts.Length % 3 != 0)
+                throw new ArgumentException("points must be packed x, y, z triplets");
+            return pts.Length / 3;
+        }
+
+        private static int Check(int ret)
+        {
+            if (ret == NativeMethods.ErrorBufferTooSmall)
+                throw new ArgumentException("output buffer too small");
+            if (ret < 0)
+                throw new ArgumentException("invalid argument");
+            return ret;
+        }
+    }
+}